@@ -1,6 +1,7 @@
 #version 450
 
 layout(location = 0) in flat int colorID;
+layout(location = 1) in float fade;
 
 layout(location = 0) out vec4 outColor;
 
@@ -19,5 +20,5 @@ void main() {
 
     vec3 col = palette[colorID % 6]/255.0;
 
-    outColor = vec4(vec3(col), fac);
+    outColor = vec4(vec3(col), fade * fac);
 }
\ No newline at end of file
@@ -1,8 +1,7 @@
 #version 450
 
-layout(location = 0) in vec2 inPosition;
-
 layout(location = 0) out int colorID;
+layout(location = 1) out float fade;
 
 layout(binding = 0) uniform UniformBufferObject {
     mat4 MVP;
@@ -11,9 +10,43 @@ layout(binding = 0) uniform UniformBufferObject {
     float DeltaTime;
 } ubo;
 
+// Only positions are fetched, see ParticleData.glsl for the layouts:
+#ifdef PARTICLE_SOA
+layout(std430, binding = 2) readonly buffer PositionSSBO {
+   vec2 positions[ ];
+};
+#else
+struct Particle {
+    vec2 pos;
+    vec2 vel;
+};
+
+layout(std140, binding = 2) readonly buffer ParticleSSBO {
+   Particle particles[ ];
+};
+#endif
+
+layout(std430, binding = 4) readonly buffer LifeSSBO {
+   float life[ ];
+};
+
+layout(std430, binding = 5) readonly buffer AliveSSBO {
+   uint aliveIndices[ ];
+};
+
 void main() {
+    // Vertex count comes from the alive counter, so only live particles are drawn:
+    uint index = aliveIndices[gl_VertexIndex];
+
+#ifdef PARTICLE_SOA
+    vec2 pos = positions[index];
+#else
+    vec2 pos = particles[index].pos;
+#endif
+
     gl_PointSize = ubo.PointSize;
-    gl_Position = ubo.MVP * vec4(inPosition, 0.0, 1.0);
+    gl_Position = ubo.MVP * vec4(pos, 0.0, 1.0);
 
-    colorID = gl_VertexIndex;
+    colorID = int(index);
+    fade = clamp(2.0 * life[index], 0.0, 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,116 @@
+// Declarations shared by the particle compute shaders.
+// Storage layout of particle state is selected at compile time:
+//   default           - array of structs {vec2 pos; vec2 vel;}, std140
+//   PARTICLE_SOA      - separate std430 arrays of positions and velocities
+//   PARTICLE_HALF_VEL - (with PARTICLE_SOA) velocities packed as half2
+
+struct Emitter {
+    vec2 Position;
+    float Spread;
+    float Speed;
+    float Lifetime;
+    uint SpawnCount;
+    uint SpawnOffset;
+    float Pad;
+};
+
+layout (binding = 0) uniform ParameterUBO {
+    mat4 MVP;
+    float PointSize;
+    float Speed;
+    float DeltaTime;
+    uint ParticleCount;
+    uint EmitCount;
+    uint EmitterCount;
+    uint Seed;
+    float Pad;
+    Emitter Emitters[4];
+} ubo;
+
+#ifdef PARTICLE_SOA
+
+layout(std430, binding = 1) readonly buffer PositionSSBOIn {
+   vec2 positionsIn[ ];
+};
+
+layout(std430, binding = 2) buffer PositionSSBOOut {
+   vec2 positionsOut[ ];
+};
+
+#ifdef PARTICLE_HALF_VEL
+
+layout(std430, binding = 8) readonly buffer VelocitySSBOIn {
+   uint velocitiesIn[ ];
+};
+
+layout(std430, binding = 9) buffer VelocitySSBOOut {
+   uint velocitiesOut[ ];
+};
+
+vec2 LoadVelocity(uint index) { return unpackHalf2x16(velocitiesIn[index]); }
+void StoreVelocity(uint index, vec2 vel) { velocitiesOut[index] = packHalf2x16(vel); }
+
+#else
+
+layout(std430, binding = 8) readonly buffer VelocitySSBOIn {
+   vec2 velocitiesIn[ ];
+};
+
+layout(std430, binding = 9) buffer VelocitySSBOOut {
+   vec2 velocitiesOut[ ];
+};
+
+vec2 LoadVelocity(uint index) { return velocitiesIn[index]; }
+void StoreVelocity(uint index, vec2 vel) { velocitiesOut[index] = vel; }
+
+#endif
+
+vec2 LoadPosition(uint index) { return positionsIn[index]; }
+void StorePosition(uint index, vec2 pos) { positionsOut[index] = pos; }
+
+#else
+
+struct Particle {
+    vec2 pos;
+    vec2 vel;
+};
+
+layout(std140, binding = 1) readonly buffer ParticleSSBOIn {
+   Particle particlesIn[ ];
+};
+
+layout(std140, binding = 2) buffer ParticleSSBOOut {
+   Particle particlesOut[ ];
+};
+
+vec2 LoadPosition(uint index) { return particlesIn[index].pos; }
+vec2 LoadVelocity(uint index) { return particlesIn[index].vel; }
+void StorePosition(uint index, vec2 pos) { particlesOut[index].pos = pos; }
+void StoreVelocity(uint index, vec2 vel) { particlesOut[index].vel = vel; }
+
+#endif
+
+layout(std430, binding = 3) readonly buffer LifeSSBOIn {
+   float lifeIn[ ];
+};
+
+layout(std430, binding = 4) buffer LifeSSBOOut {
+   float lifeOut[ ];
+};
+
+layout(std430, binding = 5) buffer AliveSSBO {
+   uint aliveIndices[ ];
+};
+
+layout(std430, binding = 6) buffer FreeSSBO {
+   uint freeIndices[ ];
+};
+
+// First four members double as VkDrawIndirectCommand:
+layout(std430, binding = 7) buffer CounterSSBO {
+   uint aliveCount;
+   uint instanceCount;
+   uint firstVertex;
+   uint firstInstance;
+   int freeCount;
+};
\ No newline at end of file
@@ -1,7 +1,13 @@
 #version 450
 
+#ifdef VERTEX_PULLING
+#extension GL_GOOGLE_include_directive : require
+
+#include "VertexPulling.glsl"
+#else
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec2 inTexCoord;
+#endif
 
 layout(location = 0) out vec2 fragTexCoord;
 
@@ -10,6 +16,11 @@ layout(binding = 0) uniform UniformBufferObject {
 } ubo;
 
 void main() {
+#ifdef VERTEX_PULLING
+    vec3 inPosition = FetchVec3(0);
+    vec2 inTexCoord = FetchVec2(3);
+#endif
+
     gl_Position = ubo.MVP * vec4(inPosition, 1.0);
 
     fragTexCoord = inTexCoord;
@@ -1,7 +1,13 @@
 #version 450
 
+#ifdef VERTEX_PULLING
+#extension GL_GOOGLE_include_directive : require
+
+#include "VertexPulling.glsl"
+#else
 layout(location = 0) in vec2 inPosition;
 layout(location = 1) in vec2 inTexCoord;
+#endif
 
 layout(location = 0) out vec2 fragTexCoord;
 
@@ -11,6 +17,11 @@ layout(binding = 0) uniform UniformBufferObject {
 } ubo;
 
 void main() {
+#ifdef VERTEX_PULLING
+    vec2 inPosition = FetchVec2(0);
+    vec2 inTexCoord = FetchVec2(2);
+#endif
+
     float c = cos(ubo.Phi), s = sin(ubo.Phi);
     mat2 rot = mat2(c, -s, s, c);
 
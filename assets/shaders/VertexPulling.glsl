@@ -0,0 +1,32 @@
+// Vertex fetching through a buffer device address, included by vertex shaders
+// compiled with VERTEX_PULLING. Vertices are read as tightly packed floats,
+// so any layout can be fetched without fixed-function vertex input.
+// Push constants match GeometryArena::PullConstants.
+
+#extension GL_EXT_buffer_reference : require
+
+layout(buffer_reference, std430, buffer_reference_align = 4) readonly buffer FloatBuffer {
+    float data[];
+};
+
+layout(push_constant) uniform PullConstants {
+    FloatBuffer Vertices;
+    // In floats:
+    uint VertexStride;
+} pull;
+
+// gl_VertexIndex already includes the vertex offset of indexed draws:
+float FetchFloat(uint offset)
+{
+    return pull.Vertices.data[uint(gl_VertexIndex) * pull.VertexStride + offset];
+}
+
+vec2 FetchVec2(uint offset)
+{
+    return vec2(FetchFloat(offset), FetchFloat(offset + 1));
+}
+
+vec3 FetchVec3(uint offset)
+{
+    return vec3(FetchFloat(offset), FetchFloat(offset + 1), FetchFloat(offset + 2));
+}
\ No newline at end of file
@@ -9,6 +9,26 @@ def get_files(dir: str, regex: str):
 SOURCE_DIR = "assets/shaders"
 SPIRV_DIR = "assets/spirv"
 
+# Additional builds of some shaders with preprocessor defines,
+# as (name suffix, defines), e.g. Particle.comp -> ParticleSoAComp.spv
+PARTICLE_VARIANTS = [
+    ("SoA", ["PARTICLE_SOA"]),
+    ("SoAHalf", ["PARTICLE_SOA", "PARTICLE_HALF_VEL"]),
+]
+
+# Vertices fetched through buffer device address (--vertex-pulling):
+PULLING_VARIANTS = [
+    ("Pulled", ["VERTEX_PULLING"]),
+]
+
+VARIANTS = {
+    "Particle.comp": PARTICLE_VARIANTS,
+    "Particle.vert": PARTICLE_VARIANTS,
+    "ParticleEmit.comp": PARTICLE_VARIANTS,
+    "TexturedQuad.vert": PULLING_VARIANTS,
+    "TexturedCube.vert": PULLING_VARIANTS,
+}
+
 result_dir = pathlib.Path(SPIRV_DIR)
 result_dir.mkdir(parents=True, exist_ok=True)
 
@@ -18,8 +38,8 @@ comps = get_files(SOURCE_DIR, "*.comp")
 
 filepaths = verts + frags + comps;
 
-for path in filepaths:
-    result_name = path.stem
+def compile(path, suffix: str, defines: list):
+    result_name = path.stem + suffix
     ext = path.suffix
 
     if ext == ".vert":
@@ -31,4 +51,13 @@ for path in filepaths:
 
     result_path = result_dir / result_name
 
-    subprocess.run(["glslc", path, "-o", result_path])
\ No newline at end of file
+    flags = ["-D" + define for define in defines]
+
+    # Buffer references need SPIR-V newer than the 1.0 default:
+    subprocess.run(["glslc", path, "--target-env=vulkan1.3", *flags, "-o", result_path])
+
+for path in filepaths:
+    compile(path, "", [])
+
+    for suffix, defines in VARIANTS.get(path.name, []):
+        compile(path, suffix, defines)
\ No newline at end of file
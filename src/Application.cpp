@@ -7,10 +7,25 @@
 #include "TexturedCube.h"
 #include "TexturedQuad.h"
 
+#include "MemoryStats.h"
+#include "Profiler.h"
+#include "Utils.h"
+
 #include "imgui.h"
 
-Application::Application() : m_Ctx(800, 600, "Vulkanik", static_cast<void *>(this))
+#include <algorithm>
+#include <iostream>
+
+Application::Application(Settings settings)
+    : m_Ctx(800, 600, "Vulkanik", settings, static_cast<void *>(this)), m_Geometry(m_Ctx),
+      m_DescriptorLayouts(m_Ctx)
 {
+    Profiler::SetThreadName("Main");
+
+    m_Ctx.Jobs = &m_Jobs;
+    m_Ctx.Geometry = &m_Geometry;
+    m_Ctx.DescriptorLayouts = &m_DescriptorLayouts;
+
     RecreateRenderer(true);
     m_RecreateRenderer = false;
 
@@ -27,13 +42,39 @@ void Application::Run()
 {
     while (!m_Ctx.Window.ShouldClose())
     {
+        Profiler::NewFrame();
+        PROFILE_SCOPE("Application::Run");
+
+        // E.g. GLFW calls requested by the renderer loader or workers:
+        m_Jobs.RunMainThreadJobs();
+
         using ms = std::chrono::duration<float, std::milli>;
 
         auto currentTime = std::chrono::high_resolution_clock::now();
         mDeltaTime = std::chrono::duration_cast<ms>(currentTime - mOldTime).count();
         mOldTime = currentTime;
 
-        if (m_RecreateRenderer)
+        m_FrameStats.AddFrame(mDeltaTime);
+        m_FrameStats.ResolveLatency(utils::CompletedTimelineValue(m_Ctx));
+
+        DestroyRetiredRenderers();
+        m_Ctx.CollectDeferredDeletions();
+
+        // Out of date swapchains get recreated right away, suboptimal ones
+        // go through the same coalescing as resize events:
+        if (m_Ctx.SwapchainSuboptimal || !m_Ctx.SwapchainOk)
+        {
+            m_Ctx.SwapchainSuboptimal = false;
+            RequestSwapchainRecreation();
+        }
+
+        HandleSwapchainRecreation();
+
+        if (m_PendingRenderer.valid())
+        {
+            SwapPendingRenderer();
+        }
+        else if (m_RecreateRenderer)
         {
             RecreateRenderer();
             m_RecreateRenderer = false;
@@ -41,26 +82,99 @@ void Application::Run()
 
         // Swapchain logic based on:
         // https://gist.github.com/nanokatze/bb03a486571e13a7b6a8709368bd87cf#file-handling-window-resize-md
-        m_Renderer->OnUpdate(mDeltaTime);
+        {
+            PROFILE_SCOPE("OnUpdate");
+            m_Renderer->OnUpdate(mDeltaTime);
+        }
+
+        // Nothing to render into while minimized, until a resize event restores it:
+        bool minimized = m_Ctx.Width == 0 || m_Ctx.Height == 0;
 
-        if (m_Ctx.SwapchainOk)
+        if (m_Ctx.SwapchainOk && !minimized)
         {
             m_Ctx.Window.PollEvents();
         }
+        else if (m_PendingRenderer.valid())
+        {
+            // Keep checking if the pending renderer finished:
+            m_Ctx.Window.WaitEventsTimeout(0.01);
+            continue;
+        }
         else
         {
             m_Ctx.Window.WaitEvents();
             continue;
         }
 
-        m_ImGuiCtx.BeginGuiFrame();
-        m_Renderer->OnImGui();
-        m_ImGuiCtx.FinalizeGuiFrame();
+        auto inputTime = std::chrono::steady_clock::now();
+
+        {
+            PROFILE_SCOPE("ImGui");
+
+            m_ImGuiCtx.BeginGuiFrame();
+            m_Renderer->OnImGui();
+            m_Renderer->OnGpuProfilerImGui();
+            Profiler::OnImGui();
+            MemoryStats::OnImGui(m_Ctx);
+
+            if (ImGui::IsKeyPressed(ImGuiKey_F3, false))
+                m_ShowFrameStats = !m_ShowFrameStats;
+
+            if (ImGui::IsKeyPressed(ImGuiKey_F10, false))
+                MemoryStats::SaveJson(m_Ctx, m_Ctx.Config.VmaDumpPath);
+
+            if (m_ShowFrameStats)
+                m_ImGuiCtx.DrawFrameStatsOverlay(m_FrameStats);
+
+            if (m_PendingRenderer.valid())
+            {
+                ImGui::SetNextWindowPos(ImVec2(10.0f, 10.0f));
+                ImGui::Begin("Loading", nullptr,
+                             ImGuiWindowFlags_NoDecoration |
+                                 ImGuiWindowFlags_AlwaysAutoResize);
+                ImGui::Text("Loading renderer...");
+                ImGui::End();
+            }
+
+            m_ImGuiCtx.FinalizeGuiFrame();
+        }
+
+        auto lastSubmitted = m_Ctx.GraphicsTimeline.LastSubmitted;
 
         m_Renderer->OnRender();
+
+        // Frame counts as rendered once its last submission completes:
+        if (m_Ctx.GraphicsTimeline.LastSubmitted != lastSubmitted)
+            m_FrameStats.MarkInput(m_Ctx.GraphicsTimeline.LastSubmitted, inputTime);
+
+        m_FrameStats.ResolveLatency(utils::CompletedTimelineValue(m_Ctx));
     }
 
-    vkDeviceWaitIdle(m_Ctx.Device);
+    // Let background construction finish, it can't be interrupted
+    // (but may need the main thread in the meantime):
+    if (m_PendingRenderer.valid())
+    {
+        using namespace std::chrono_literals;
+
+        while (m_PendingRenderer.wait_for(1ms) != std::future_status::ready)
+            m_Jobs.RunMainThreadJobs();
+    }
+
+    // Before anything is released, so the dump shows the final state:
+    if (m_Ctx.Config.VmaDumpOnExit)
+    {
+        auto &path = m_Ctx.Config.VmaDumpPath;
+
+        // Window is about to close, so the failure can only be reported here:
+        if (!MemoryStats::SaveJson(m_Ctx, path))
+            std::cerr << "Failed to write VMA statistics to " << path << '\n';
+    }
+
+    utils::DeviceWaitIdle(m_Ctx);
+
+    m_RetiredRenderers.clear();
+    m_RendererPool.Clear();
+
     // Here not in the destructor, to avoid triggering when an exception is thrown
     // as that results in imgui assert preventing the exception from propagating
     // up and being printed to cerr.
@@ -69,23 +183,266 @@ void Application::Run()
 
 void Application::OnResize(uint32_t width, uint32_t height)
 {
-    m_Ctx.SwapchainOk = false;
+    // Only the latest extent matters, recreation happens in the frame loop:
     m_Ctx.Width = width;
     m_Ctx.Height = height;
 
+    RequestSwapchainRecreation();
+}
+
+void Application::RequestSwapchainRecreation()
+{
+    auto now = std::chrono::steady_clock::now();
+
+    if (!m_RecreateSwapchain)
+        m_FirstRecreateRequest = now;
+
+    m_LastRecreateRequest = now;
+    m_RecreateSwapchain = true;
+}
+
+void Application::HandleSwapchainRecreation()
+{
+    if (!m_RecreateSwapchain)
+        return;
+
+    // Renderer under construction reads the swapchain, so recreation waits
+    // until it is swapped in:
+    if (m_PendingRenderer.valid())
+        return;
+
+    // Minimized window, nothing to create:
+    if (m_Ctx.Width == 0 || m_Ctx.Height == 0)
+        return;
+
+    // Drag-resizing emits events every frame. Until they settle, frames are
+    // rendered into the old swapchain clamped to the window, unless it can't
+    // be presented anymore or the resize takes long enough to be noticeable:
+    auto now = std::chrono::steady_clock::now();
+
+    bool settled = now - m_LastRecreateRequest >= RESIZE_SETTLE_TIME;
+    bool overdue = now - m_FirstRecreateRequest >= RESIZE_MAX_DELAY;
+
+    if (!settled && !overdue && m_Ctx.SwapchainOk)
+        return;
+
+    m_RecreateSwapchain = false;
     m_Renderer->RecreateSwapchain();
 }
 
 void Application::RecreateRenderer(bool first_run)
+{
+    PROFILE_SCOPE("Application::RecreateRenderer");
+
+    if (first_run)
+    {
+        // Nothing to present in the meantime, so construct synchronously:
+        auto loaded = LoadRenderer(m_RendererType);
+
+        m_Renderer = std::move(loaded.Renderer);
+        m_RendererFootprint = loaded.Footprint;
+        m_ActiveRendererType = m_RendererType;
+
+        m_ImGuiCtx.OnInit(m_Ctx, m_Renderer.get());
+        return;
+    }
+
+    // Suspended renderers only need to recreate per-swapchain resources:
+    VkDeviceSize footprint = 0;
+
+    if (auto renderer = m_RendererPool.Acquire(m_RendererType, footprint))
+    {
+        ScopedFramePhase phase(FramePhase::RendererRecreation);
+
+        renderer->Resume();
+        SwapRenderer(LoadedRenderer{std::move(renderer), footprint}, m_RendererType);
+        return;
+    }
+
+    // Loading models, textures and building pipelines happens on a background
+    // thread, while the current renderer keeps presenting:
+    m_PendingRendererType = m_RendererType;
+    m_PendingRenderer = std::async(std::launch::async, [this, type = m_RendererType]() {
+        Profiler::SetThreadName("Renderer loader");
+        ScopedFramePhase::DisableOnThisThread();
+
+        return LoadRenderer(type);
+    });
+}
+
+void Application::SwapPendingRenderer()
+{
+    using namespace std::chrono_literals;
+
+    if (m_PendingRenderer.wait_for(0s) != std::future_status::ready)
+        return;
+
+    PROFILE_SCOPE("Application::SwapPendingRenderer");
+    ScopedFramePhase phase(FramePhase::RendererRecreation);
+
+    // Rethrows exceptions from construction:
+    SwapRenderer(m_PendingRenderer.get(), m_PendingRendererType);
+}
+
+void Application::SwapRenderer(LoadedRenderer loaded, SupportedRenderer type)
+{
+    // Suspending waits for frames of the old renderer, which may still use
+    // imgui backend resources:
+    if (m_RendererOutdated)
+    {
+        m_Renderer->WaitForFrames();
+        m_RetiredRenderers.push_back(std::move(m_Renderer));
+        m_RendererOutdated = false;
+    }
+    else
+    {
+        m_RendererPool.Release(m_Ctx, m_ActiveRendererType, std::move(m_Renderer),
+                               m_RendererFootprint, m_RetiredRenderers);
+    }
+
+    m_Renderer = std::move(loaded.Renderer);
+    m_RendererFootprint = loaded.Footprint;
+    m_ActiveRendererType = type;
+
+    m_ImGuiCtx.OnRendererChanged(m_Ctx, m_Renderer.get());
+}
+
+void Application::DestroyRetiredRenderers()
+{
+    // Note that destructors cleaning up vulkan resources are
+    // called automatically
+    std::erase_if(m_RetiredRenderers, [](const auto &renderer) {
+        return renderer->IsIdle();
+    });
+}
+
+Application::LoadedRenderer Application::LoadRenderer(SupportedRenderer type)
+{
+    // Approximate, since other threads may allocate at the same time:
+    auto before = utils::AllocatedBytes(m_Ctx);
+
+    auto renderer = CreateRenderer(type);
+
+    auto after = utils::AllocatedBytes(m_Ctx);
+
+    return LoadedRenderer{
+        .Renderer = std::move(renderer),
+        .Footprint = after - std::min(before, after),
+    };
+}
+
+const char *Application::RendererName(SupportedRenderer type)
 {
     using enum SupportedRenderer;
 
-    if (!first_run)
+    switch (type)
+    {
+    case MainMenu:
+        return "Main Menu";
+    case HelloTraingle:
+        return "Hello Triangle";
+    case TexturedQuad:
+        return "Textured Quad";
+    case TexturedCube:
+        return "Textured Cube";
+    case ComputeParticle:
+        return "Compute Particles";
+    case Model:
+        return "Model";
+    }
+
+    return "Unknown";
+}
+
+void Application::RendererPoolImGui()
+{
+    if (!ImGui::CollapsingHeader("Renderer cache"))
+        return;
+
+    constexpr float MiB = 1024.0f * 1024.0f;
+
+    int budget = static_cast<int>(m_RendererPool.Budget >> 20);
+
+    if (ImGui::SliderInt("Budget (MiB)", &budget, 0, 2048))
+    {
+        m_RendererPool.Budget = static_cast<VkDeviceSize>(budget) << 20;
+        m_RendererPool.Trim(m_RetiredRenderers);
+    }
+
+    ImGui::Text("Usage: %.2f MiB", static_cast<float>(m_RendererPool.Usage()) / MiB);
+
+    for (auto &entry : m_RendererPool.Entries())
+    {
+        ImGui::BulletText("%s: %.2f MiB", RendererName(entry.Type),
+                          static_cast<float>(entry.Footprint) / MiB);
+    }
+}
+
+void Application::FramePacingImGui()
+{
+    if (!ImGui::CollapsingHeader("Frame pacing"))
+        return;
+
+    auto &config = m_Ctx.Config;
+
+    int framesInFlight = static_cast<int>(config.FramesInFlight);
+
+    // Renderer under construction reads it on another thread:
+    ImGui::BeginDisabled(m_PendingRenderer.valid());
+
+    bool framesChanged =
+        ImGui::SliderInt("Frames in flight", &framesInFlight,
+                         Settings::MIN_FRAMES_IN_FLIGHT, Settings::MAX_FRAMES_IN_FLIGHT);
+
+    ImGui::EndDisabled();
+
+    if (framesChanged)
     {
-        vkDeviceWaitIdle(m_Ctx.Device);
-        m_ImGuiCtx.OnDestroy(m_Ctx);
+        config.FramesInFlight = static_cast<uint32_t>(framesInFlight);
+
+        // Per-frame resources are sized at construction, so cached renderers
+        // are stale and the current one needs to be rebuilt:
+        m_RendererPool.Clear();
+        m_RendererOutdated = true;
+        m_RecreateRenderer = true;
+    }
+
+    int swapchainImages = static_cast<int>(config.SwapchainImages);
+
+    if (ImGui::SliderInt("Swapchain images", &swapchainImages, 0, 8,
+                         swapchainImages == 0 ? "default" : "%d"))
+    {
+        config.SwapchainImages = static_cast<uint32_t>(swapchainImages);
+        RequestSwapchainRecreation();
     }
 
+    if (ImGui::BeginCombo("Present mode", Settings::PresentModeName(config.PresentMode)))
+    {
+        for (auto mode : m_Ctx.SupportedPresentModes)
+        {
+            bool selected = mode == config.PresentMode;
+
+            if (ImGui::Selectable(Settings::PresentModeName(mode), selected) &&
+                !selected)
+            {
+                config.PresentMode = mode;
+                RequestSwapchainRecreation();
+            }
+        }
+
+        ImGui::EndCombo();
+    }
+
+    ImGui::Text("Swapchain: %u images, %s", m_Ctx.Swapchain.image_count,
+                Settings::PresentModeName(m_Ctx.Swapchain.present_mode));
+    ImGui::Text("Input to GPU completion: %.2f ms (avg %.2f ms)",
+                m_FrameStats.LatestLatency(), m_FrameStats.AverageLatency());
+}
+
+std::unique_ptr<RendererBase> Application::CreateRenderer(SupportedRenderer type)
+{
+    using enum SupportedRenderer;
+
     auto go_back = [this]() {
         if (ImGui::ArrowButton("Go back", static_cast<ImGuiDir>(0)))
         {
@@ -127,37 +484,27 @@ void Application::RecreateRenderer(bool first_run)
             m_RecreateRenderer = true;
             m_RendererType = Model;
         }
+
+        ImGui::Separator();
+        RendererPoolImGui();
+        FramePacingImGui();
     };
 
-    switch (m_RendererType)
+    switch (type)
     {
-    // Note that destructors cleaning up vulkan resources are
-    // called automatically
-    case MainMenu: {
-        m_Renderer = std::make_unique<MainMenuRenderer>(m_Ctx, menu);
-        break;
-    }
-    case HelloTraingle: {
-        m_Renderer = std::make_unique<HelloTriangleRenderer>(m_Ctx, go_back);
-        break;
-    }
-    case TexturedQuad: {
-        m_Renderer = std::make_unique<TexturedQuadRenderer>(m_Ctx, go_back);
-        break;
-    }
-    case TexturedCube: {
-        m_Renderer = std::make_unique<TexturedCubeRenderer>(m_Ctx, go_back);
-        break;
-    }
-    case ComputeParticle: {
-        m_Renderer = std::make_unique<ComputeParticleRenderer>(m_Ctx, go_back);
-        break;
-    }
-    case Model: {
-        m_Renderer = std::make_unique<ModelRenderer>(m_Ctx, go_back);
-        break;
-    }
+    case MainMenu:
+        return std::make_unique<MainMenuRenderer>(m_Ctx, menu);
+    case HelloTraingle:
+        return std::make_unique<HelloTriangleRenderer>(m_Ctx, go_back);
+    case TexturedQuad:
+        return std::make_unique<TexturedQuadRenderer>(m_Ctx, go_back);
+    case TexturedCube:
+        return std::make_unique<TexturedCubeRenderer>(m_Ctx, go_back);
+    case ComputeParticle:
+        return std::make_unique<ComputeParticleRenderer>(m_Ctx, go_back);
+    case Model:
+        return std::make_unique<ModelRenderer>(m_Ctx, go_back);
     }
 
-    m_ImGuiCtx.OnInit(m_Ctx, m_Renderer.get());
+    throw std::runtime_error("Unsupported renderer type!");
 }
\ No newline at end of file
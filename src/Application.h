@@ -1,16 +1,24 @@
 #pragma once
 
+#include "Descriptor.h"
+#include "FrameStats.h"
+#include "GeometryArena.h"
 #include "ImGuiContext.h"
+#include "JobSystem.h"
 #include "VulkanContext.h"
 
 #include "RendererBase.h"
+#include "RendererPool.h"
+#include "Settings.h"
 
 #include <chrono>
+#include <future>
 #include <memory>
+#include <vector>
 
 class Application {
   public:
-    Application();
+    explicit Application(Settings settings = {});
     ~Application();
 
     void Run();
@@ -18,11 +26,6 @@ class Application {
     void OnResize(uint32_t width, uint32_t height);
 
   private:
-    void RecreateRenderer(bool first_run = false);
-
-  private:
-    VulkanContext m_Ctx;
-
     enum class SupportedRenderer
     {
         MainMenu,
@@ -33,13 +36,71 @@ class Application {
         Model,
     };
 
+    struct LoadedRenderer {
+        std::unique_ptr<RendererBase> Renderer;
+        VkDeviceSize Footprint;
+    };
+
+    static const char *RendererName(SupportedRenderer type);
+
+    void RecreateRenderer(bool first_run = false);
+    std::unique_ptr<RendererBase> CreateRenderer(SupportedRenderer type);
+    LoadedRenderer LoadRenderer(SupportedRenderer type);
+
+    void SwapPendingRenderer();
+    void SwapRenderer(LoadedRenderer loaded, SupportedRenderer type);
+    void DestroyRetiredRenderers();
+
+    void RequestSwapchainRecreation();
+    void HandleSwapchainRecreation();
+
+    void RendererPoolImGui();
+    void FramePacingImGui();
+
+  private:
+    // Declared first, so it outlives everything that could submit jobs:
+    JobSystem m_Jobs;
+
+    VulkanContext m_Ctx;
+
+    // Declared before renderers, so their meshes are freed before it is destroyed:
+    GeometryArena m_Geometry;
+    // Same for layouts, which renderers use without owning them:
+    DescriptorLayoutCache m_DescriptorLayouts;
+
     SupportedRenderer m_RendererType = SupportedRenderer::MainMenu;
     bool m_RecreateRenderer = true;
 
     std::unique_ptr<RendererBase> m_Renderer = nullptr;
+    SupportedRenderer m_ActiveRendererType = SupportedRenderer::MainMenu;
+    VkDeviceSize m_RendererFootprint = 0;
+    // Active renderer was built for a previous configuration, so it gets
+    // retired instead of returning to the pool:
+    bool m_RendererOutdated = false;
+
+    // Suspended renderers, to make switching back to them fast:
+    RendererPool<SupportedRenderer> m_RendererPool;
+
+    // New renderer being constructed in the background, current one keeps
+    // presenting until it is ready:
+    std::future<LoadedRenderer> m_PendingRenderer;
+    SupportedRenderer m_PendingRendererType = SupportedRenderer::MainMenu;
+    // Previous renderers, destroyed once their submitted frames finish:
+    std::vector<std::unique_ptr<RendererBase>> m_RetiredRenderers;
+
+    // Resize events are coalesced, at most one recreation happens per frame:
+    static constexpr auto RESIZE_SETTLE_TIME = std::chrono::milliseconds(50);
+    static constexpr auto RESIZE_MAX_DELAY = std::chrono::milliseconds(200);
+
+    bool m_RecreateSwapchain = false;
+    std::chrono::steady_clock::time_point m_FirstRecreateRequest;
+    std::chrono::steady_clock::time_point m_LastRecreateRequest;
 
     ImGuiContextManager m_ImGuiCtx;
 
+    FrameStats m_FrameStats;
+    bool m_ShowFrameStats = true;
+
     float mDeltaTime = 0.0f;
     std::chrono::time_point<std::chrono::high_resolution_clock> mOldTime;
 };
\ No newline at end of file
@@ -0,0 +1,180 @@
+#include "FrameStats.h"
+
+#include <algorithm>
+#include <atomic>
+
+// Nanoseconds spent in each phase since the last AddFrame:
+static std::array<std::atomic<uint64_t>, FrameStats::PHASE_COUNT> PhaseAccumulators{};
+
+// Nesting depth of each phase on the current thread:
+static thread_local std::array<uint32_t, FrameStats::PHASE_COUNT> PhaseDepth{};
+static thread_local bool PhasesDisabled = false;
+
+void ScopedFramePhase::DisableOnThisThread()
+{
+    PhasesDisabled = true;
+}
+
+ScopedFramePhase::ScopedFramePhase(FramePhase phase) : mPhase(phase)
+{
+    auto idx = static_cast<size_t>(mPhase);
+
+    mOutermost = PhaseDepth[idx]++ == 0 && !PhasesDisabled;
+
+    if (mOutermost)
+        mStart = std::chrono::steady_clock::now();
+}
+
+ScopedFramePhase::~ScopedFramePhase()
+{
+    auto idx = static_cast<size_t>(mPhase);
+
+    PhaseDepth[idx]--;
+
+    if (!mOutermost)
+        return;
+
+    auto elapsed = std::chrono::steady_clock::now() - mStart;
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+
+    PhaseAccumulators[idx].fetch_add(static_cast<uint64_t>(ns),
+                                     std::memory_order_relaxed);
+}
+
+void FrameStats::AddFrame(float milliseconds)
+{
+    std::array<float, PHASE_COUNT> phases{};
+
+    for (size_t i = 0; i < PHASE_COUNT; i++)
+    {
+        auto ns = PhaseAccumulators[i].exchange(0, std::memory_order_relaxed);
+        phases[i] = 1e-6f * static_cast<float>(ns);
+    }
+
+    mFrameCount++;
+
+    mFrameTimes.push_back(milliseconds);
+    if (mFrameTimes.size() > WINDOW_SIZE)
+        mFrameTimes.pop_front();
+
+    if (milliseconds < HitchThreshold)
+        return;
+
+    auto maxPhase = std::max_element(phases.begin(), phases.end());
+
+    auto cause = *maxPhase > 0.0f
+                     ? static_cast<FramePhase>(std::distance(phases.begin(), maxPhase))
+                     : FramePhase::Count;
+
+    mHitches.push_back(Hitch{
+        .Frame = mFrameCount,
+        .Milliseconds = milliseconds,
+        .PhaseMilliseconds = phases,
+        .Cause = cause,
+    });
+
+    if (mHitches.size() > MAX_HITCHES)
+        mHitches.pop_front();
+}
+
+void FrameStats::MarkInput(uint64_t timelineValue,
+                           std::chrono::steady_clock::time_point time)
+{
+    mPendingInputs.push_back(PendingInput{.TimelineValue = timelineValue, .Time = time});
+}
+
+void FrameStats::ResolveLatency(uint64_t completedValue)
+{
+    auto now = std::chrono::steady_clock::now();
+
+    while (!mPendingInputs.empty() &&
+           mPendingInputs.front().TimelineValue <= completedValue)
+    {
+        using ms = std::chrono::duration<float, std::milli>;
+
+        auto elapsed = now - mPendingInputs.front().Time;
+        mLatencies.push_back(std::chrono::duration_cast<ms>(elapsed).count());
+        mPendingInputs.pop_front();
+
+        if (mLatencies.size() > LATENCY_WINDOW)
+            mLatencies.pop_front();
+    }
+}
+
+float FrameStats::LatestLatency() const
+{
+    return mLatencies.empty() ? 0.0f : mLatencies.back();
+}
+
+float FrameStats::AverageLatency() const
+{
+    if (mLatencies.empty())
+        return 0.0f;
+
+    float sum = 0.0f;
+
+    for (float latency : mLatencies)
+        sum += latency;
+
+    return sum / static_cast<float>(mLatencies.size());
+}
+
+float FrameStats::Percentile(float p) const
+{
+    if (mFrameTimes.empty())
+        return 0.0f;
+
+    std::vector<float> sorted(mFrameTimes.begin(), mFrameTimes.end());
+
+    auto rank = static_cast<size_t>(p * static_cast<float>(sorted.size() - 1) + 0.5f);
+    rank = std::min(rank, sorted.size() - 1);
+
+    std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+
+    return sorted[rank];
+}
+
+float FrameStats::Max() const
+{
+    if (mFrameTimes.empty())
+        return 0.0f;
+
+    return *std::max_element(mFrameTimes.begin(), mFrameTimes.end());
+}
+
+std::vector<float> FrameStats::Histogram(size_t binCount) const
+{
+    std::vector<float> bins(binCount, 0.0f);
+
+    const float max = Max();
+
+    if (binCount == 0 || max <= 0.0f)
+        return bins;
+
+    for (auto time : mFrameTimes)
+    {
+        auto bin = static_cast<size_t>(time / max * static_cast<float>(binCount));
+        bins[std::min(bin, binCount - 1)] += 1.0f;
+    }
+
+    return bins;
+}
+
+const char *FrameStats::PhaseName(FramePhase phase)
+{
+    switch (phase)
+    {
+    case FramePhase::SwapchainRecreation:
+        return "Swapchain recreation";
+    case FramePhase::RendererRecreation:
+        return "Renderer recreation";
+    case FramePhase::PipelineBuild:
+        return "Pipeline build";
+    case FramePhase::Upload:
+        return "Upload";
+    case FramePhase::Count:
+        break;
+    }
+
+    return "Unknown";
+}
\ No newline at end of file
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+/// Known sources of long frames, time spent in them is tracked per frame.
+enum class FramePhase
+{
+    SwapchainRecreation,
+    RendererRecreation,
+    PipelineBuild,
+    Upload,
+    Count,
+};
+
+/**
+    Rolling window of frame times with percentiles and hitch detection.
+    Time spent in each FramePhase is accumulated (from any thread) by
+    ScopedFramePhase and attributed to the frame it happened in,
+    so hitches can report what caused them.
+*/
+class FrameStats {
+  public:
+    static constexpr size_t WINDOW_SIZE = 1024;
+    static constexpr size_t MAX_HITCHES = 16;
+    static constexpr size_t LATENCY_WINDOW = 128;
+    static constexpr size_t PHASE_COUNT = static_cast<size_t>(FramePhase::Count);
+
+    struct Hitch {
+        uint64_t Frame;
+        float Milliseconds;
+        std::array<float, PHASE_COUNT> PhaseMilliseconds;
+
+        // Phase that took the most time, or Count if none was recorded:
+        FramePhase Cause;
+    };
+
+    // Takes time of the previous frame, along with phases accumulated during it:
+    void AddFrame(float milliseconds);
+
+    [[nodiscard]] float Percentile(float p) const;
+    [[nodiscard]] float Max() const;
+
+    [[nodiscard]] const std::deque<float> &FrameTimes() const
+    {
+        return mFrameTimes;
+    }
+
+    [[nodiscard]] const std::deque<Hitch> &Hitches() const
+    {
+        return mHitches;
+    }
+
+    [[nodiscard]] uint64_t FrameCount() const
+    {
+        return mFrameCount;
+    }
+
+    // Bins frame times from 0 to Max() into the given number of buckets:
+    [[nodiscard]] std::vector<float> Histogram(size_t binCount) const;
+
+    // Input-to-GPU-completion latency. Frames are identified by the timeline value
+    // of their last submission, and resolved once the GPU has reached it:
+    void MarkInput(uint64_t timelineValue, std::chrono::steady_clock::time_point time);
+    void ResolveLatency(uint64_t completedValue);
+
+    [[nodiscard]] float LatestLatency() const;
+    [[nodiscard]] float AverageLatency() const;
+
+    static const char *PhaseName(FramePhase phase);
+
+  public:
+    float HitchThreshold = 33.3f;
+
+  private:
+    std::deque<float> mFrameTimes;
+    std::deque<Hitch> mHitches;
+    uint64_t mFrameCount = 0;
+
+    struct PendingInput {
+        uint64_t TimelineValue;
+        std::chrono::steady_clock::time_point Time;
+    };
+    std::deque<PendingInput> mPendingInputs;
+    std::deque<float> mLatencies;
+};
+
+/// Adds time spent in its scope to the given phase. Nested scopes of the
+/// same phase on one thread are only counted once.
+class ScopedFramePhase {
+  public:
+    explicit ScopedFramePhase(FramePhase phase);
+    ~ScopedFramePhase();
+
+    // For threads doing work that doesn't stall frames (e.g. background loading):
+    static void DisableOnThisThread();
+
+    ScopedFramePhase(const ScopedFramePhase &) = delete;
+    ScopedFramePhase &operator=(const ScopedFramePhase &) = delete;
+
+  private:
+    FramePhase mPhase;
+    bool mOutermost;
+    std::chrono::steady_clock::time_point mStart;
+};
\ No newline at end of file
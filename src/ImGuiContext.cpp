@@ -4,7 +4,10 @@
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_vulkan.h"
 
-#include "Utils.h"
+#include <algorithm>
+#include <cfloat>
+#include <cstdio>
+#include <stdexcept>
 
 static void ImGuiStyleCustom();
 
@@ -12,7 +15,26 @@ void ImGuiContextManager::OnInit(VulkanContext &ctx, const RendererBase *const r
 {
     CreateDescriptorPool(ctx);
     InitImGui();
-    InitImGuiVulkanBackend(ctx, renderer);
+
+    ImGui_ImplGlfw_InitForVulkan(ctx.Window.get(), true);
+
+    m_RenderData = renderer->getImGuiData();
+    InitImGuiVulkanBackend(ctx);
+}
+
+void ImGuiContextManager::OnRendererChanged(VulkanContext &ctx,
+                                            const RendererBase *const renderer)
+{
+    auto rdata = renderer->getImGuiData();
+
+    if (rdata == m_RenderData)
+        return;
+
+    // Font atlas stays on the cpu side, the backend only re-uploads it:
+    ImGui_ImplVulkan_Shutdown();
+
+    m_RenderData = rdata;
+    InitImGuiVulkanBackend(ctx);
 }
 
 void ImGuiContextManager::InitImGui()
@@ -51,6 +73,75 @@ void ImGuiContextManager::FinalizeGuiFrame()
     ImGui::Render();
 }
 
+void ImGuiContextManager::DrawFrameStatsOverlay(FrameStats &stats)
+{
+    constexpr float padding = 10.0f;
+
+    const auto *viewport = ImGui::GetMainViewport();
+    auto pos = ImVec2(viewport->WorkPos.x + viewport->WorkSize.x - padding,
+                      viewport->WorkPos.y + padding);
+
+    ImGui::SetNextWindowPos(pos, ImGuiCond_Always, ImVec2(1.0f, 0.0f));
+    ImGui::SetNextWindowBgAlpha(0.6f);
+
+    auto flags = ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_AlwaysAutoResize |
+                 ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_NoFocusOnAppearing |
+                 ImGuiWindowFlags_NoNav;
+
+    ImGui::Begin("Frame stats", nullptr, flags);
+
+    ImGui::Text("Frame times (last %zu frames), F3 to hide", stats.FrameTimes().size());
+    ImGui::Text("p50: %.2f ms  p99: %.2f ms  p99.9: %.2f ms", stats.Percentile(0.5f),
+                stats.Percentile(0.99f), stats.Percentile(0.999f));
+    ImGui::Text("Input to GPU completion: %.2f ms (avg %.2f ms)", stats.LatestLatency(),
+                stats.AverageLatency());
+
+    auto histogram = stats.Histogram(32);
+    char overlay[32];
+    std::snprintf(overlay, sizeof(overlay), "0 - %.1f ms", stats.Max());
+
+    ImGui::PlotHistogram("##histogram", histogram.data(),
+                         static_cast<int>(histogram.size()), 0, overlay, 0.0f,
+                         FLT_MAX, ImVec2(260.0f, 60.0f));
+
+    ImGui::PushItemWidth(120.0f);
+    ImGui::SliderFloat("Hitch threshold", &stats.HitchThreshold, 5.0f, 200.0f,
+                       "%.1f ms");
+    ImGui::PopItemWidth();
+
+    if (!stats.Hitches().empty())
+    {
+        ImGui::Separator();
+        ImGui::Text("Recent hitches:");
+
+        for (auto it = stats.Hitches().rbegin(); it != stats.Hitches().rend(); ++it)
+        {
+            auto frame = static_cast<unsigned long long>(it->Frame);
+            auto cause = it->Cause == FramePhase::Count
+                             ? "unattributed"
+                             : FrameStats::PhaseName(it->Cause);
+
+            ImGui::Text("Frame %llu: %.1f ms, %s", frame, it->Milliseconds, cause);
+
+            if (ImGui::IsItemHovered())
+            {
+                ImGui::BeginTooltip();
+
+                for (size_t i = 0; i < FrameStats::PHASE_COUNT; i++)
+                {
+                    auto phase = static_cast<FramePhase>(i);
+                    ImGui::Text("%s: %.2f ms", FrameStats::PhaseName(phase),
+                                it->PhaseMilliseconds[i]);
+                }
+
+                ImGui::EndTooltip();
+            }
+        }
+    }
+
+    ImGui::End();
+}
+
 void ImGuiContextManager::RecordImguiToCommandBuffer(VkCommandBuffer commandBuffer)
 {
     ImDrawData *draw_data = ImGui::GetDrawData();
@@ -86,12 +177,9 @@ void ImGuiContextManager::CreateDescriptorPool(VulkanContext &ctx)
         abort();
 }
 
-void ImGuiContextManager::InitImGuiVulkanBackend(VulkanContext &ctx,
-                                                 const RendererBase *const renderer)
+void ImGuiContextManager::InitImGuiVulkanBackend(VulkanContext &ctx)
 {
-    auto rdata = renderer->getImGuiData();
-
-    ImGui_ImplGlfw_InitForVulkan(ctx.Window.get(), true);
+    auto &rdata = m_RenderData;
 
     ImGui_ImplVulkan_InitInfo init_info = {};
 
@@ -107,8 +195,9 @@ void ImGuiContextManager::InitImGuiVulkanBackend(VulkanContext &ctx,
 
     init_info.Queue = rdata.Queue;
     init_info.DescriptorPool = m_ImguiPool;
-    init_info.MinImageCount = rdata.FramesInFlight;
-    init_info.ImageCount = rdata.FramesInFlight;
+    // Backend requires at least two, even with a single frame in flight:
+    init_info.MinImageCount = std::max(rdata.FramesInFlight, 2u);
+    init_info.ImageCount = std::max(rdata.FramesInFlight, 2u);
     init_info.MSAASamples = rdata.MSAA;
     init_info.CheckVkResultFn = check_vk_result;
     init_info.UseDynamicRendering = true;
@@ -118,11 +207,8 @@ void ImGuiContextManager::InitImGuiVulkanBackend(VulkanContext &ctx,
     init_info.PipelineRenderingCreateInfo.sType =
         VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
     init_info.PipelineRenderingCreateInfo.colorAttachmentCount = 1;
-    init_info.PipelineRenderingCreateInfo.pColorAttachmentFormats =
-        &ctx.Swapchain.image_format;
-    ;
-    init_info.PipelineRenderingCreateInfo.depthAttachmentFormat =
-        utils::FindDepthFormat(ctx);
+    init_info.PipelineRenderingCreateInfo.pColorAttachmentFormats = &rdata.ColorFormat;
+    init_info.PipelineRenderingCreateInfo.depthAttachmentFormat = rdata.DepthFormat;
 
     ImGui_ImplVulkan_Init(&init_info);
 }
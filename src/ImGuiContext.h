@@ -1,22 +1,37 @@
 #pragma once
 
+#include "FrameStats.h"
 #include "RendererBase.h"
 #include "VulkanContext.h"
 
+/**
+    Owns the imgui context (with its font atlas), descriptor pool and
+    platform backend for the whole application lifetime.
+    Only the Vulkan backend depends on the renderer (queue, image count
+    and attachment formats) and is recreated when those change.
+*/
 class ImGuiContextManager {
   public:
     void OnInit(VulkanContext &ctx, const RendererBase *const renderer);
     void OnDestroy(VulkanContext &ctx);
 
+    // Frames of the previous renderer must be finished before calling this:
+    void OnRendererChanged(VulkanContext &ctx, const RendererBase *const renderer);
+
     void BeginGuiFrame();
     void FinalizeGuiFrame();
 
+    void DrawFrameStatsOverlay(FrameStats &stats);
+
     static void RecordImguiToCommandBuffer(VkCommandBuffer commandBuffer);
 
   private:
     VkDescriptorPool m_ImguiPool;
 
+    // Kept alive, since the backend refers to the color format:
+    RenderDataForImGui m_RenderData;
+
     void InitImGui();
     void CreateDescriptorPool(VulkanContext &ctx);
-    void InitImGuiVulkanBackend(VulkanContext &ctx, const RendererBase *const renderer);
+    void InitImGuiVulkanBackend(VulkanContext &ctx);
 };
\ No newline at end of file
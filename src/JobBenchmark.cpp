@@ -0,0 +1,151 @@
+#include "JobBenchmark.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <future>
+#include <vector>
+
+// Best of several runs, to filter out scheduling noise:
+static double MeasureMicroseconds(const std::function<void()> &function)
+{
+    constexpr int REPETITIONS = 5;
+
+    double best = 0.0;
+
+    for (int i = 0; i < REPETITIONS; i++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        function();
+        std::chrono::duration<double, std::micro> time =
+            std::chrono::steady_clock::now() - start;
+
+        best = (i == 0) ? time.count() : std::min(best, time.count());
+    }
+
+    return best;
+}
+
+static void AppendLine(std::string &report, const char *name, double jobsUs,
+                       double asyncUs, const char *unit)
+{
+    std::array<char, 256> line{};
+
+    std::snprintf(line.data(), line.size(), "%-28s %10.3f %-6s %10.3f %-6s x%.2f\n",
+                  name, jobsUs, unit, asyncUs, unit, asyncUs / jobsUs);
+    report += line.data();
+}
+
+std::string JobBenchmark::Run(JobSystem &jobs)
+{
+    std::string report;
+
+    {
+        std::array<char, 256> line{};
+        std::snprintf(line.data(), line.size(), "Job system: %zu threads\n\n",
+                      jobs.NumThreads());
+        report += line.data();
+
+        std::snprintf(line.data(), line.size(), "%-28s %17s %17s %s\n", "",
+                      "jobs", "std::async", "speedup");
+        report += line.data();
+    }
+
+    // Round trip of a single empty job, i.e. wake up and completion latency:
+    {
+        constexpr int COUNT = 1000;
+
+        double jobsUs = MeasureMicroseconds([&]() {
+            for (int i = 0; i < COUNT; i++)
+            {
+                TaskGroup group;
+                jobs.Submit(group, []() {});
+                jobs.Wait(group);
+            }
+        });
+
+        double asyncUs = MeasureMicroseconds([&]() {
+            for (int i = 0; i < COUNT; i++)
+                std::async(std::launch::async, []() {}).get();
+        });
+
+        AppendLine(report, "Single job round trip", jobsUs / COUNT, asyncUs / COUNT,
+                   "us");
+    }
+
+    // Many small jobs, dominated by enqueue and scheduling overhead:
+    {
+        constexpr int COUNT = 10000;
+        std::atomic<int> counter = 0;
+
+        double jobsUs = MeasureMicroseconds([&]() {
+            TaskGroup group;
+
+            for (int i = 0; i < COUNT; i++)
+                jobs.Submit(group, [&counter]() { counter++; });
+
+            jobs.Wait(group);
+        });
+
+        double asyncUs = MeasureMicroseconds([&]() {
+            std::vector<std::future<void>> futures;
+            futures.reserve(COUNT);
+
+            for (int i = 0; i < COUNT; i++)
+            {
+                futures.push_back(
+                    std::async(std::launch::async, [&counter]() { counter++; }));
+            }
+
+            for (auto &future : futures)
+                future.get();
+        });
+
+        AppendLine(report, "Empty job throughput", 1000.0 * jobsUs / COUNT,
+                   1000.0 * asyncUs / COUNT, "ns/job");
+    }
+
+    // Data parallel loop, async gets one chunk per thread as it can't afford more:
+    {
+        constexpr size_t COUNT = 1 << 24;
+        constexpr size_t BATCH = 1 << 14;
+
+        std::vector<float> data(COUNT);
+
+        for (size_t i = 0; i < COUNT; i++)
+            data[i] = static_cast<float>(i % 1024);
+
+        auto transform = [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+                data[i] = std::sqrt(data[i] * data[i] + 1.0f);
+        };
+
+        double jobsUs =
+            MeasureMicroseconds([&]() { jobs.ParallelFor(COUNT, BATCH, transform); });
+
+        double asyncUs = MeasureMicroseconds([&]() {
+            size_t numChunks = jobs.NumThreads();
+            size_t chunkSize = (COUNT + numChunks - 1) / numChunks;
+
+            std::vector<std::future<void>> futures;
+
+            for (size_t begin = 0; begin < COUNT; begin += chunkSize)
+            {
+                size_t end = std::min(begin + chunkSize, COUNT);
+                futures.push_back(std::async(std::launch::async, transform, begin, end));
+            }
+
+            for (auto &future : futures)
+                future.get();
+        });
+
+        AppendLine(report, "Parallel for (16M floats)", jobsUs / 1000.0, asyncUs / 1000.0,
+                   "ms");
+    }
+
+    return report;
+}
\ No newline at end of file
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "JobSystem.h"
+
+#include <string>
+
+/// Micro-benchmark comparing the job system with std::async,
+/// run from the command line with --job-benchmark.
+namespace JobBenchmark
+{
+[[nodiscard]] std::string Run(JobSystem &jobs);
+} // namespace JobBenchmark
\ No newline at end of file
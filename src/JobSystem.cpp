@@ -0,0 +1,342 @@
+#include "JobSystem.h"
+
+#include "Profiler.h"
+
+#include <algorithm>
+#include <utility>
+
+// Owning system and queue index of the current worker thread:
+static thread_local JobSystem *tWorkerSystem = nullptr;
+static thread_local size_t tWorkerQueue = 0;
+
+size_t JobSystem::DefaultWorkerCount()
+{
+    // Calling thread is expected to take part in the work as well:
+    return std::max<size_t>(std::thread::hardware_concurrency(), 2) - 1;
+}
+
+JobSystem::JobSystem(size_t numWorkers) : mMainThread(std::this_thread::get_id())
+{
+    // Injection queue is the last one:
+    for (size_t i = 0; i < numWorkers + 1; i++)
+        mQueues.push_back(std::make_unique<WorkQueue>());
+
+    for (size_t i = 0; i < numWorkers; i++)
+        mWorkers.emplace_back(&JobSystem::WorkerLoop, this, i);
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard lock(mSleepMutex);
+        mQuit = true;
+    }
+    mSleepCondition.notify_all();
+
+    for (auto &worker : mWorkers)
+        worker.join();
+}
+
+void JobSystem::Submit(TaskGroup &group, Job job)
+{
+    group.mPending.fetch_add(1, std::memory_order_relaxed);
+
+    Enqueue(QueuedJob{std::move(job), &group});
+}
+
+void JobSystem::Submit(TaskGroup &group, Job job,
+                       std::span<TaskGroup *const> dependencies)
+{
+    group.mPending.fetch_add(1, std::memory_order_relaxed);
+
+    auto dependent = std::make_shared<TaskGroup::Dependent>();
+    dependent->Function = std::move(job);
+    dependent->Group = &group;
+    // Extra count held during registration, so the job can't start halfway through:
+    dependent->Remaining = dependencies.size() + 1;
+
+    size_t satisfied = 1;
+
+    for (auto dependency : dependencies)
+    {
+        std::lock_guard lock(dependency->mMutex);
+
+        // Last job of a group takes its lock before starting dependents,
+        // so a finished group is never missed here:
+        if (dependency->mPending.load(std::memory_order_acquire) == 0)
+            satisfied++;
+        else
+            dependency->mDependents.push_back(dependent);
+    }
+
+    if (dependent->Remaining.fetch_sub(satisfied, std::memory_order_acq_rel) ==
+        satisfied)
+    {
+        Enqueue(QueuedJob{std::move(dependent->Function), &group});
+    }
+}
+
+void JobSystem::SubmitToMainThread(TaskGroup &group, Job job)
+{
+    group.mPending.fetch_add(1, std::memory_order_relaxed);
+
+    {
+        std::lock_guard lock(mMainThreadMutex);
+        mMainThreadJobs.push_back(QueuedJob{std::move(job), &group});
+        mHasMainThreadJobs.store(true, std::memory_order_seq_cst);
+    }
+
+    // Main thread may be blocked in Wait:
+    WakeWaitingThreads();
+}
+
+void JobSystem::RunMainThreadJobs()
+{
+    std::vector<QueuedJob> jobs;
+
+    {
+        std::lock_guard lock(mMainThreadMutex);
+        jobs.swap(mMainThreadJobs);
+        mHasMainThreadJobs.store(false, std::memory_order_relaxed);
+    }
+
+    for (auto &job : jobs)
+        RunJob(job);
+}
+
+void JobSystem::Wait(TaskGroup &group)
+{
+    PROFILE_SCOPE("JobSystem::Wait");
+
+    const bool isMainThread = IsMainThread();
+
+    while (!group.Done())
+    {
+        // Main thread jobs can't be run by anyone else:
+        if (isMainThread)
+            RunMainThreadJobs();
+
+        if (TryRunJob())
+            continue;
+
+        // Nothing to help with, sleep until there is new work or the group finishes:
+        std::unique_lock lock(mSleepMutex);
+
+        mWaitingThreads.fetch_add(1, std::memory_order_seq_cst);
+        mWaitCondition.wait(lock, [&]() {
+            // Sequentially consistent, pairs with the checks in WakeWaitingThreads:
+            bool done = group.mPending.load(std::memory_order_seq_cst) == 0 &&
+                        group.mFinishing.load(std::memory_order_seq_cst) == 0;
+            bool mainThreadWork =
+                isMainThread && mHasMainThreadJobs.load(std::memory_order_seq_cst);
+
+            return done || mainThreadWork ||
+                   mQueuedJobs.load(std::memory_order_seq_cst) > 0;
+        });
+        mWaitingThreads.fetch_sub(1, std::memory_order_seq_cst);
+    }
+
+    std::exception_ptr error;
+
+    {
+        std::lock_guard lock(group.mMutex);
+        error = std::exchange(group.mError, nullptr);
+    }
+
+    if (error)
+        std::rethrow_exception(error);
+}
+
+void JobSystem::ParallelFor(size_t count, size_t batchSize,
+                            const std::function<void(size_t, size_t)> &function)
+{
+    batchSize = std::max<size_t>(batchSize, 1);
+
+    auto batch = [&](size_t begin) {
+        function(begin, std::min(begin + batchSize, count));
+    };
+
+    TaskGroup group;
+
+    // Capturing only a reference and an index fits in std::function's small buffer:
+    for (size_t begin = batchSize; begin < count; begin += batchSize)
+        Submit(group, [&batch, begin]() { batch(begin); });
+
+    // Calling thread takes the first batch:
+    if (count > 0)
+    {
+        try
+        {
+            batch(0);
+        }
+        catch (...)
+        {
+            // Jobs still reference the batch, so they must finish first:
+            Wait(group);
+            throw;
+        }
+    }
+
+    Wait(group);
+}
+
+void JobSystem::Enqueue(QueuedJob job)
+{
+    // Workers push to their own queue, everyone else to the injection queue:
+    size_t queueIdx = tWorkerSystem == this ? tWorkerQueue : mWorkers.size();
+
+    {
+        auto &queue = *mQueues[queueIdx];
+        std::lock_guard lock(queue.Mutex);
+        queue.Jobs.push_back(std::move(job));
+    }
+
+    mQueuedJobs.fetch_add(1, std::memory_order_seq_cst);
+
+    // Taking the lock orders this with a worker that is about to sleep:
+    if (mSleepingWorkers.load(std::memory_order_seq_cst) > 0)
+    {
+        {
+            std::lock_guard lock(mSleepMutex);
+        }
+        mSleepCondition.notify_one();
+    }
+
+    // Waiting threads help with the new job as well:
+    WakeWaitingThreads();
+}
+
+void JobSystem::WakeWaitingThreads()
+{
+    // Same ordering as for sleeping workers in Enqueue:
+    if (mWaitingThreads.load(std::memory_order_seq_cst) > 0)
+    {
+        {
+            std::lock_guard lock(mSleepMutex);
+        }
+        mWaitCondition.notify_all();
+    }
+}
+
+bool JobSystem::PopJob(QueuedJob &job)
+{
+    const size_t numQueues = mQueues.size();
+    const bool isWorker = tWorkerSystem == this;
+
+    // Own queue first, newest job while it is still in cache:
+    if (isWorker)
+    {
+        auto &queue = *mQueues[tWorkerQueue];
+        std::lock_guard lock(queue.Mutex);
+
+        if (!queue.Jobs.empty())
+        {
+            job = std::move(queue.Jobs.back());
+            queue.Jobs.pop_back();
+            return true;
+        }
+    }
+
+    // Then steal the oldest jobs, starting at a different queue on each thread:
+    size_t start = isWorker ? tWorkerQueue + 1 : numQueues - 1;
+
+    for (size_t i = 0; i < numQueues; i++)
+    {
+        auto &queue = *mQueues[(start + i) % numQueues];
+
+        // Skips contended queues, they get revisited on the next attempt:
+        std::unique_lock lock(queue.Mutex, std::try_to_lock);
+
+        if (!lock.owns_lock() || queue.Jobs.empty())
+            continue;
+
+        job = std::move(queue.Jobs.front());
+        queue.Jobs.pop_front();
+        return true;
+    }
+
+    return false;
+}
+
+bool JobSystem::TryRunJob()
+{
+    QueuedJob job;
+
+    if (!PopJob(job))
+        return false;
+
+    mQueuedJobs.fetch_sub(1, std::memory_order_relaxed);
+
+    RunJob(job);
+    return true;
+}
+
+void JobSystem::RunJob(QueuedJob &job)
+{
+    try
+    {
+        job.Function();
+    }
+    catch (...)
+    {
+        std::lock_guard lock(job.Group->mMutex);
+
+        if (!job.Group->mError)
+            job.Group->mError = std::current_exception();
+    }
+
+    FinishJob(*job.Group);
+}
+
+void JobSystem::FinishJob(TaskGroup &group)
+{
+    group.mFinishing.fetch_add(1, std::memory_order_acq_rel);
+
+    if (group.mPending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        std::vector<std::shared_ptr<TaskGroup::Dependent>> dependents;
+
+        {
+            std::lock_guard lock(group.mMutex);
+            dependents.swap(group.mDependents);
+        }
+
+        for (auto &dependent : dependents)
+        {
+            if (dependent->Remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                Enqueue(QueuedJob{std::move(dependent->Function), dependent->Group});
+        }
+    }
+
+    // Last access, the group may be destroyed right after:
+    if (group.mFinishing.fetch_sub(1, std::memory_order_seq_cst) == 1)
+    {
+        // Group may be done now, its waiters have to check:
+        WakeWaitingThreads();
+    }
+}
+
+void JobSystem::WorkerLoop(size_t workerIdx)
+{
+    Profiler::SetThreadName("Job worker");
+
+    tWorkerSystem = this;
+    tWorkerQueue = workerIdx;
+
+    while (true)
+    {
+        if (TryRunJob())
+            continue;
+
+        std::unique_lock lock(mSleepMutex);
+
+        mSleepingWorkers.fetch_add(1, std::memory_order_seq_cst);
+        mSleepCondition.wait(lock, [this]() {
+            return mQuit || mQueuedJobs.load(std::memory_order_seq_cst) > 0;
+        });
+        mSleepingWorkers.fetch_sub(1, std::memory_order_seq_cst);
+
+        if (mQuit)
+            return;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+/// Tracks unfinished jobs submitted to it. Other jobs can depend on a group,
+/// in which case they start only once all of its jobs have finished.
+/// Must outlive its jobs, i.e. JobSystem::Wait has to be called before destroying it.
+class TaskGroup {
+  public:
+    TaskGroup() = default;
+
+    TaskGroup(const TaskGroup &) = delete;
+    TaskGroup &operator=(const TaskGroup &) = delete;
+
+    [[nodiscard]] bool Done() const
+    {
+        return mPending.load(std::memory_order_acquire) == 0 &&
+               mFinishing.load(std::memory_order_acquire) == 0;
+    }
+
+  private:
+    friend class JobSystem;
+
+    struct Dependent {
+        std::function<void()> Function;
+        TaskGroup *Group;
+        std::atomic<size_t> Remaining;
+    };
+
+    std::atomic<size_t> mPending = 0;
+    // Jobs past their function, which may still touch the group:
+    std::atomic<size_t> mFinishing = 0;
+
+    std::mutex mMutex;
+    // Jobs waiting for this group, started by its last finishing job:
+    std::vector<std::shared_ptr<Dependent>> mDependents;
+    // First exception thrown by a job, rethrown from Wait:
+    std::exception_ptr mError;
+};
+
+/**
+    Work-stealing job scheduler shared by the whole application.
+    Every worker pushes and pops jobs at the back of its own deque and steals
+    from the front of the others, jobs submitted by other threads go
+    to a shared injection queue. Deques are guarded by per-queue mutexes,
+    which are almost never contended, so submitting a job costs a lock and
+    (for small captures) no allocation.
+    Threads waiting for a group run pending jobs in the meantime, and sleep
+    once there are none left.
+    The thread constructing the system is considered the main thread and runs
+    jobs requiring it (e.g. GLFW calls) in RunMainThreadJobs.
+*/
+class JobSystem {
+  public:
+    using Job = std::function<void()>;
+
+    explicit JobSystem(size_t numWorkers = DefaultWorkerCount());
+    ~JobSystem();
+
+    JobSystem(const JobSystem &) = delete;
+    JobSystem &operator=(const JobSystem &) = delete;
+
+    void Submit(TaskGroup &group, Job job);
+    // Job starts only after all jobs of the dependencies have finished:
+    void Submit(TaskGroup &group, Job job, std::span<TaskGroup *const> dependencies);
+
+    // Queues a job to be run by the main thread on its next RunMainThreadJobs:
+    void SubmitToMainThread(TaskGroup &group, Job job);
+    // Called by the main thread once per frame:
+    void RunMainThreadJobs();
+
+    // Runs other jobs until the group is done, then rethrows the first
+    // exception thrown by its jobs:
+    void Wait(TaskGroup &group);
+
+    // Calls function(begin, end) for consecutive ranges of at most batchSize
+    // indices, returns once all of them are done:
+    void ParallelFor(size_t count, size_t batchSize,
+                     const std::function<void(size_t, size_t)> &function);
+
+    // Workers and the calling thread:
+    [[nodiscard]] size_t NumThreads() const
+    {
+        return mWorkers.size() + 1;
+    }
+
+    [[nodiscard]] bool IsMainThread() const
+    {
+        return std::this_thread::get_id() == mMainThread;
+    }
+
+    static size_t DefaultWorkerCount();
+
+  private:
+    struct QueuedJob {
+        Job Function;
+        TaskGroup *Group;
+    };
+
+    struct WorkQueue {
+        std::mutex Mutex;
+        std::deque<QueuedJob> Jobs;
+    };
+
+    void Enqueue(QueuedJob job);
+    bool PopJob(QueuedJob &job);
+    bool TryRunJob();
+    void RunJob(QueuedJob &job);
+    void FinishJob(TaskGroup &group);
+    void WakeWaitingThreads();
+
+    void WorkerLoop(size_t workerIdx);
+
+  private:
+    std::thread::id mMainThread;
+    std::vector<std::thread> mWorkers;
+
+    // One queue per worker, followed by the injection queue:
+    std::vector<std::unique_ptr<WorkQueue>> mQueues;
+    std::atomic<size_t> mQueuedJobs = 0;
+
+    std::mutex mMainThreadMutex;
+    std::vector<QueuedJob> mMainThreadJobs;
+    std::atomic<bool> mHasMainThreadJobs = false;
+
+    std::mutex mSleepMutex;
+    std::condition_variable mSleepCondition;
+    std::atomic<size_t> mSleepingWorkers = 0;
+    // Threads blocked in Wait, woken by new jobs and by finished groups:
+    std::condition_variable mWaitCondition;
+    std::atomic<size_t> mWaitingThreads = 0;
+    bool mQuit = false;
+};
\ No newline at end of file
@@ -0,0 +1,132 @@
+#include "MemoryStats.h"
+
+#include "imgui.h"
+
+#include <array>
+#include <cstdio>
+#include <fstream>
+
+// Set by a failed SaveJson, cleared by the next successful one:
+static std::string SaveError;
+
+static void UploadText(const char *name, const UploadStats::Counter &counter)
+{
+    constexpr float MiB = 1024.0f * 1024.0f;
+
+    ImGui::Text("%s uploads: %llu, %.2f MiB", name,
+                static_cast<unsigned long long>(counter.Count.load()),
+                static_cast<float>(counter.Bytes.load()) / MiB);
+}
+
+void MemoryStats::OnImGui(VulkanContext &ctx)
+{
+    ImGui::SetNextWindowCollapsed(true, ImGuiCond_FirstUseEver);
+
+    // Calculating statistics walks all memory blocks, so it is skipped while collapsed:
+    if (!ImGui::Begin("Memory"))
+    {
+        ImGui::End();
+        return;
+    }
+
+    constexpr float MiB = 1024.0f * 1024.0f;
+
+    const VkPhysicalDeviceMemoryProperties *properties = nullptr;
+    vmaGetMemoryProperties(ctx.Allocator, &properties);
+
+    std::array<VmaBudget, VK_MAX_MEMORY_HEAPS> budgets{};
+    vmaGetHeapBudgets(ctx.Allocator, budgets.data());
+
+    VmaTotalStatistics stats;
+    vmaCalculateStatistics(ctx.Allocator, &stats);
+
+    ImGui::Text("Budgets: %s", ctx.MemoryBudgetSupported ? "VK_EXT_memory_budget"
+                                                          : "estimated by VMA");
+    ImGui::Text("Allocations: %u in %u blocks", stats.total.statistics.allocationCount,
+                stats.total.statistics.blockCount);
+
+    if (ImGui::Button("Save json (F10)"))
+        SaveJson(ctx, ctx.Config.VmaDumpPath);
+
+    ImGui::SameLine();
+    ImGui::Text("%s", ctx.Config.VmaDumpPath.c_str());
+
+    if (!SaveError.empty())
+        ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%s", SaveError.c_str());
+
+    UploadText(ctx.DirectUploadSupported ? "Direct" : "Direct (disabled)",
+               ctx.Uploads.Direct);
+    UploadText("Staged", ctx.Uploads.Staged);
+
+    for (uint32_t i = 0; i < properties->memoryHeapCount; i++)
+    {
+        const auto &heap = properties->memoryHeaps[i];
+        const auto &budget = budgets[i];
+        const auto &heapStats = stats.memoryHeap[i];
+
+        bool deviceLocal = heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+
+        ImGui::Separator();
+        ImGui::Text("Heap %u (%s): %.1f MiB", i, deviceLocal ? "device local" : "host",
+                    static_cast<float>(heap.size) / MiB);
+
+        // Usage includes other processes and memory not allocated through VMA:
+        float usage = static_cast<float>(budget.usage) / MiB;
+        float available = static_cast<float>(budget.budget) / MiB;
+
+        char overlay[64];
+        std::snprintf(overlay, sizeof(overlay), "%.1f / %.1f MiB", usage, available);
+
+        ImGui::ProgressBar(available > 0.0f ? usage / available : 0.0f,
+                           ImVec2(260.0f, 0.0f), overlay);
+
+        ImGui::Text("%u allocations: %.1f MiB in %u blocks of %.1f MiB",
+                    heapStats.statistics.allocationCount,
+                    static_cast<float>(heapStats.statistics.allocationBytes) / MiB,
+                    heapStats.statistics.blockCount,
+                    static_cast<float>(heapStats.statistics.blockBytes) / MiB);
+
+        // Share of free block memory unusable for an allocation of the total free size:
+        VkDeviceSize free =
+            heapStats.statistics.blockBytes - heapStats.statistics.allocationBytes;
+        VkDeviceSize largest = heapStats.unusedRangeSizeMax;
+
+        float fragmentation =
+            free > 0 ? 1.0f - static_cast<float>(largest) / static_cast<float>(free)
+                     : 0.0f;
+
+        ImGui::Text("Free: %.1f MiB, largest block %.1f MiB, fragmentation %.1f%%",
+                    static_cast<float>(free) / MiB, static_cast<float>(largest) / MiB,
+                    100.0f * fragmentation);
+    }
+
+    ImGui::End();
+}
+
+bool MemoryStats::SaveJson(VulkanContext &ctx, const std::string &path, bool detailed)
+{
+    std::ofstream file(path);
+
+    if (!file)
+    {
+        SaveError = "Failed to open " + path;
+        return false;
+    }
+
+    char *json = nullptr;
+    vmaBuildStatsString(ctx.Allocator, &json, detailed ? VK_TRUE : VK_FALSE);
+
+    file << json;
+    file.close();
+
+    vmaFreeStatsString(ctx.Allocator, json);
+
+    if (!file)
+    {
+        SaveError = "Failed to write " + path;
+        return false;
+    }
+
+    SaveError.clear();
+    return true;
+}
\ No newline at end of file
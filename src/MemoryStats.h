@@ -0,0 +1,22 @@
+#pragma once
+
+#include "VulkanContext.h"
+
+#include <string>
+
+/**
+    Device memory statistics gathered from VMA. Heap budgets are exact when
+    VK_EXT_memory_budget is available (VulkanContext::MemoryBudgetSupported)
+    and estimated by VMA otherwise. Full statistics can be dumped as json,
+    to diff memory usage between versions. Also shows the buffer upload counts
+    of VulkanContext::Uploads.
+*/
+namespace MemoryStats
+{
+// Per-heap usage and budget, allocation counts and fragmentation:
+void OnImGui(VulkanContext &ctx);
+
+// Output of vmaBuildStatsString, detailed also lists every allocation.
+// Returns false if the file couldn't be written, failures are also shown in the window:
+bool SaveJson(VulkanContext &ctx, const std::string &path, bool detailed = true);
+} // namespace MemoryStats
\ No newline at end of file
@@ -0,0 +1,395 @@
+#include "Profiler.h"
+
+#include "imgui.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+struct ZoneRecord {
+    const char *Name;
+    uint64_t Start;
+    uint64_t End;
+    uint32_t Depth;
+};
+
+/// Single producer (owning thread), single consumer (main thread) ring buffer.
+class ThreadBuffer {
+  public:
+    static constexpr uint64_t CAPACITY = 1 << 14;
+
+    bool Push(const ZoneRecord &record)
+    {
+        auto head = mHead.load(std::memory_order_relaxed);
+
+        if (head - mTail.load(std::memory_order_acquire) == CAPACITY)
+            return false;
+
+        mRecords[head % CAPACITY] = record;
+        mHead.store(head + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    template <typename F>
+    void Drain(F &&func)
+    {
+        auto tail = mTail.load(std::memory_order_relaxed);
+        auto head = mHead.load(std::memory_order_acquire);
+
+        for (; tail != head; tail++)
+            func(mRecords[tail % CAPACITY]);
+
+        mTail.store(tail, std::memory_order_release);
+    }
+
+  public:
+    uint32_t ThreadId = 0;
+    std::string Name;
+    bool InUse = false;
+    std::atomic<uint64_t> Dropped = 0;
+
+  private:
+    std::array<ZoneRecord, CAPACITY> mRecords;
+    std::atomic<uint64_t> mHead = 0;
+    std::atomic<uint64_t> mTail = 0;
+};
+
+struct ProfilerState {
+    // Buffers are never freed, so that zones of exited threads can still
+    // be drained, instead they are reused by new threads:
+    std::mutex BuffersMutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> Buffers;
+
+    // Main thread only:
+    uint64_t FrameStart = 0;
+    uint64_t LastFrameStart = 0;
+    uint64_t LastFrameEnd = 0;
+    std::vector<std::pair<uint32_t, ZoneRecord>> LastFrame;
+    std::vector<std::pair<uint32_t, ZoneRecord>> Scratch;
+
+    bool Capturing = false;
+    std::vector<std::pair<uint32_t, ZoneRecord>> Capture;
+
+    bool Paused = false;
+};
+
+ProfilerState &State()
+{
+    static ProfilerState state;
+    return state;
+}
+
+const auto Epoch = std::chrono::steady_clock::now();
+
+// Returns the buffer to the pool when its thread exits, so that
+// short-lived threads (e.g. renderer loading) don't keep allocating:
+struct ThreadBufferHandle {
+    ThreadBuffer *Buffer = nullptr;
+
+    ~ThreadBufferHandle()
+    {
+        if (!Buffer)
+            return;
+
+        std::lock_guard lock(State().BuffersMutex);
+        Buffer->InUse = false;
+    }
+};
+
+ThreadBuffer &GetThreadBuffer()
+{
+    thread_local ThreadBufferHandle handle;
+
+    if (!handle.Buffer)
+    {
+        auto &state = State();
+        std::lock_guard lock(state.BuffersMutex);
+
+        auto it = std::find_if(state.Buffers.begin(), state.Buffers.end(),
+                               [](const auto &buffer) { return !buffer->InUse; });
+
+        if (it == state.Buffers.end())
+        {
+            auto &buffer = state.Buffers.emplace_back(std::make_unique<ThreadBuffer>());
+            buffer->ThreadId = static_cast<uint32_t>(state.Buffers.size() - 1);
+            it = state.Buffers.end() - 1;
+        }
+
+        handle.Buffer = it->get();
+        handle.Buffer->InUse = true;
+        handle.Buffer->Name = "Thread " + std::to_string(handle.Buffer->ThreadId);
+    }
+
+    return *handle.Buffer;
+}
+
+std::string EscapeJson(const char *str)
+{
+    std::string res;
+
+    for (; *str; str++)
+    {
+        if (*str == '"' || *str == '\\')
+            res += '\\';
+        res += *str;
+    }
+
+    return res;
+}
+} // namespace
+
+uint64_t Profiler::detail::Now()
+{
+    auto elapsed = std::chrono::steady_clock::now() - Epoch;
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+}
+
+void Profiler::detail::PushZone(const char *name, uint64_t start, uint32_t depth)
+{
+    auto &buffer = GetThreadBuffer();
+
+    if (!buffer.Push(ZoneRecord{name, start, Now(), depth}))
+        buffer.Dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Profiler::SetEnabled(bool enabled)
+{
+    detail::Enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void Profiler::SetThreadName(const char *name)
+{
+    auto &buffer = GetThreadBuffer();
+
+    std::lock_guard lock(State().BuffersMutex);
+    buffer.Name = name;
+}
+
+void Profiler::NewFrame()
+{
+    auto &state = State();
+
+    auto now = detail::Now();
+
+    state.Scratch.clear();
+
+    {
+        std::lock_guard lock(state.BuffersMutex);
+
+        for (auto &buffer : state.Buffers)
+        {
+            buffer->Drain([&](const ZoneRecord &record) {
+                state.Scratch.emplace_back(buffer->ThreadId, record);
+            });
+        }
+    }
+
+    if (state.Capturing)
+        state.Capture.insert(state.Capture.end(), state.Scratch.begin(),
+                             state.Scratch.end());
+
+    if (!state.Paused && !state.Scratch.empty())
+    {
+        std::swap(state.LastFrame, state.Scratch);
+        state.LastFrameStart = state.FrameStart;
+        state.LastFrameEnd = now;
+    }
+
+    state.FrameStart = now;
+}
+
+void Profiler::StartCapture()
+{
+    auto &state = State();
+
+    state.Capture.clear();
+    state.Capturing = true;
+}
+
+void Profiler::StopCapture()
+{
+    State().Capturing = false;
+}
+
+bool Profiler::IsCapturing()
+{
+    return State().Capturing;
+}
+
+void Profiler::SaveCapture(const std::string &path)
+{
+    auto &state = State();
+
+    std::ofstream file(path);
+    file << std::fixed << std::setprecision(3);
+
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+    {
+        std::lock_guard lock(state.BuffersMutex);
+
+        for (auto &buffer : state.Buffers)
+        {
+            file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":"
+                 << buffer->ThreadId << ",\"args\":{\"name\":\""
+                 << EscapeJson(buffer->Name.c_str()) << "\"}},\n";
+        }
+    }
+
+    for (size_t i = 0; i < state.Capture.size(); i++)
+    {
+        auto &[tid, zone] = state.Capture[i];
+
+        // Trace event timestamps are in microseconds:
+        file << "{\"name\":\"" << EscapeJson(zone.Name)
+             << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << tid
+             << ",\"ts\":" << static_cast<double>(zone.Start) / 1000.0
+             << ",\"dur\":" << static_cast<double>(zone.End - zone.Start) / 1000.0 << "}";
+
+        if (i + 1 < state.Capture.size())
+            file << ',';
+
+        file << '\n';
+    }
+
+    file << "]}\n";
+}
+
+void Profiler::OnImGui()
+{
+    auto &state = State();
+
+    ImGui::SetNextWindowCollapsed(true, ImGuiCond_FirstUseEver);
+    ImGui::Begin("Cpu profiler");
+
+    bool enabled = IsEnabled();
+    if (ImGui::Checkbox("Enabled", &enabled))
+        SetEnabled(enabled);
+
+    ImGui::SameLine();
+    ImGui::Checkbox("Pause", &state.Paused);
+
+    ImGui::SameLine();
+    if (!state.Capturing)
+    {
+        if (ImGui::Button("Start capture"))
+            StartCapture();
+    }
+    else
+    {
+        if (ImGui::Button("Stop and save capture"))
+        {
+            StopCapture();
+            SaveCapture("trace.json");
+        }
+
+        ImGui::SameLine();
+        ImGui::Text("%zu zones", state.Capture.size());
+    }
+
+    uint64_t dropped = 0;
+    {
+        std::lock_guard lock(state.BuffersMutex);
+
+        for (auto &buffer : state.Buffers)
+            dropped += buffer->Dropped.load(std::memory_order_relaxed);
+    }
+
+    if (dropped > 0)
+        ImGui::Text("Dropped zones: %llu", static_cast<unsigned long long>(dropped));
+
+    const auto frameDuration = state.LastFrameEnd - state.LastFrameStart;
+
+    if (state.LastFrame.empty() || frameDuration == 0)
+    {
+        ImGui::End();
+        return;
+    }
+
+    ImGui::Text("Frame: %.3f ms", 1e-6 * static_cast<double>(frameDuration));
+    ImGui::Separator();
+
+    // Flame graph, one band per thread, one row per nesting level:
+    const float rowHeight = ImGui::GetTextLineHeightWithSpacing();
+    const float width = std::max(ImGui::GetContentRegionAvail().x, 100.0f);
+
+    auto *drawList = ImGui::GetWindowDrawList();
+
+    uint32_t maxThread = 0;
+    for (auto &[tid, zone] : state.LastFrame)
+        maxThread = std::max(maxThread, tid);
+
+    for (uint32_t thread = 0; thread <= maxThread; thread++)
+    {
+        uint32_t maxDepth = 0;
+        bool any = false;
+
+        for (auto &[tid, zone] : state.LastFrame)
+        {
+            if (tid != thread)
+                continue;
+
+            maxDepth = std::max(maxDepth, zone.Depth);
+            any = true;
+        }
+
+        if (!any)
+            continue;
+
+        {
+            std::lock_guard lock(state.BuffersMutex);
+            ImGui::Text("%s", state.Buffers[thread]->Name.c_str());
+        }
+
+        const auto origin = ImGui::GetCursorScreenPos();
+        const float height = rowHeight * static_cast<float>(maxDepth + 1);
+
+        ImGui::InvisibleButton("##flame", ImVec2(width, height));
+        const bool hovered = ImGui::IsItemHovered();
+        const auto mouse = ImGui::GetMousePos();
+
+        for (auto &[tid, zone] : state.LastFrame)
+        {
+            if (tid != thread)
+                continue;
+
+            auto toX = [&](uint64_t t) {
+                auto clamped = std::clamp(t, state.LastFrameStart, state.LastFrameEnd);
+                auto rel = static_cast<double>(clamped - state.LastFrameStart);
+                return origin.x + width * static_cast<float>(rel / frameDuration);
+            };
+
+            ImVec2 min(toX(zone.Start), origin.y + rowHeight * zone.Depth);
+            ImVec2 max(std::max(toX(zone.End), min.x + 1.0f), min.y + rowHeight - 1.0f);
+
+            // Stable color derived from the name pointer:
+            auto ptr = reinterpret_cast<uintptr_t>(zone.Name);
+            auto hash = static_cast<uint32_t>(ptr >> 4) * 2654435761u;
+            auto color = IM_COL32(80 + (hash & 0x7F), 80 + ((hash >> 8) & 0x7F),
+                                  80 + ((hash >> 16) & 0x7F), 255);
+
+            drawList->AddRectFilled(min, max, color);
+
+            drawList->PushClipRect(min, max, true);
+            drawList->AddText(ImVec2(min.x + 2.0f, min.y), IM_COL32_BLACK, zone.Name);
+            drawList->PopClipRect();
+
+            if (hovered && mouse.x >= min.x && mouse.x < max.x && mouse.y >= min.y &&
+                mouse.y < max.y)
+            {
+                auto ms = 1e-6 * static_cast<double>(zone.End - zone.Start);
+                ImGui::SetTooltip("%s: %.3f ms", zone.Name, ms);
+            }
+        }
+    }
+
+    ImGui::End();
+}
\ No newline at end of file
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#define PROFILER_CONCAT_IMPL(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT_IMPL(a, b)
+
+#define PROFILE_SCOPE(name)                                                              \
+    Profiler::ScopedZone PROFILER_CONCAT(profilerZone, __LINE__)(name)
+
+/**
+    Lightweight hierarchical cpu profiler. Zones are recorded into
+    per-thread lock-free ring buffers and drained once per frame by the
+    main thread, which keeps the last frame for display and optionally
+    accumulates a capture exported as Chrome trace_event json
+    (viewable in chrome://tracing or Perfetto).
+    Zone names must be string literals (or otherwise outlive the profiler).
+*/
+namespace Profiler
+{
+namespace detail
+{
+inline std::atomic<bool> Enabled = false;
+
+uint64_t Now();
+void PushZone(const char *name, uint64_t start, uint32_t depth);
+
+inline thread_local uint32_t Depth = 0;
+} // namespace detail
+
+inline bool IsEnabled()
+{
+    return detail::Enabled.load(std::memory_order_relaxed);
+}
+
+void SetEnabled(bool enabled);
+
+void SetThreadName(const char *name);
+
+// To be called once per frame from the main thread, outside of any zone:
+void NewFrame();
+
+void StartCapture();
+void StopCapture();
+[[nodiscard]] bool IsCapturing();
+void SaveCapture(const std::string &path);
+
+void OnImGui();
+
+class ScopedZone {
+  public:
+    explicit ScopedZone(const char *name)
+    {
+        // A disabled zone costs this branch, the one in the destructor and the
+        // store of a null name. The destructor has to check what was recorded
+        // here, since the profiler can be toggled while the zone is open:
+        if (IsEnabled()) [[unlikely]]
+        {
+            mName = name;
+            mStart = detail::Now();
+            mDepth = detail::Depth++;
+        }
+    }
+
+    ~ScopedZone()
+    {
+        if (mName) [[unlikely]]
+        {
+            detail::Depth--;
+            detail::PushZone(mName, mStart, mDepth);
+        }
+    }
+
+    ScopedZone(const ScopedZone &) = delete;
+    ScopedZone &operator=(const ScopedZone &) = delete;
+
+  private:
+    // Only read when mName is set, so they stay uninitialized when disabled:
+    const char *mName = nullptr;
+    uint64_t mStart;
+    uint32_t mDepth;
+};
+} // namespace Profiler
\ No newline at end of file
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "RendererBase.h"
+#include "Utils.h"
+#include "VulkanContext.h"
+
+#include <algorithm>
+#include <list>
+#include <memory>
+#include <vector>
+
+/**
+    LRU cache of suspended renderers, so that switching back to a renderer
+    only needs to recreate its per-swapchain resources. Suspended renderers
+    keep their pipelines, buffers and textures, and are evicted (least
+    recently used first) once their total memory exceeds the budget.
+*/
+template <typename Key>
+class RendererPool {
+  public:
+    struct Entry {
+        Key Type;
+        std::unique_ptr<RendererBase> Renderer;
+        // Device memory held while suspended:
+        VkDeviceSize Footprint;
+    };
+
+    // Returns a suspended renderer of the given type (to be resumed), or nullptr:
+    std::unique_ptr<RendererBase> Acquire(Key type, VkDeviceSize &footprint)
+    {
+        for (auto it = mEntries.begin(); it != mEntries.end(); ++it)
+        {
+            if (it->Type != type)
+                continue;
+
+            auto renderer = std::move(it->Renderer);
+            footprint = it->Footprint;
+            mEntries.erase(it);
+
+            return renderer;
+        }
+
+        return nullptr;
+    }
+
+    // Suspends the renderer and stores it as the most recently used one.
+    // Renderers not fitting in the budget are moved to evicted.
+    void Release(VulkanContext &ctx, Key type, std::unique_ptr<RendererBase> renderer,
+                 VkDeviceSize footprint,
+                 std::vector<std::unique_ptr<RendererBase>> &evicted)
+    {
+        auto before = utils::AllocatedBytes(ctx);
+        renderer->Suspend();
+        auto freed = before - std::min(before, utils::AllocatedBytes(ctx));
+
+        footprint -= std::min(footprint, freed);
+
+        mEntries.push_front(Entry{type, std::move(renderer), footprint});
+
+        Trim(evicted);
+    }
+
+    void Trim(std::vector<std::unique_ptr<RendererBase>> &evicted)
+    {
+        while (!mEntries.empty() && Usage() > Budget)
+        {
+            evicted.push_back(std::move(mEntries.back().Renderer));
+            mEntries.pop_back();
+        }
+    }
+
+    void Clear()
+    {
+        mEntries.clear();
+    }
+
+    [[nodiscard]] VkDeviceSize Usage() const
+    {
+        VkDeviceSize usage = 0;
+
+        for (auto &entry : mEntries)
+            usage += entry.Footprint;
+
+        return usage;
+    }
+
+    [[nodiscard]] const std::list<Entry> &Entries() const
+    {
+        return mEntries;
+    }
+
+  public:
+    VkDeviceSize Budget = 256ull << 20;
+
+  private:
+    // Front is the most recently used:
+    std::list<Entry> mEntries;
+};
\ No newline at end of file
@@ -3,67 +3,68 @@
 #include "Utils.h"
 
 #include <array>
+#include <vector>
 
 void common::ViewportScissorDefaultBehaviour(VulkanContext &ctx, VkCommandBuffer buffer)
 {
+    // Clamped to the window while a resize is pending:
+    auto extent = ctx.GetRenderExtent();
+
     VkViewport viewport = {};
     viewport.x = 0.0f;
     viewport.y = 0.0f;
-    viewport.width = static_cast<float>(ctx.Swapchain.extent.width);
-    viewport.height = static_cast<float>(ctx.Swapchain.extent.height);
+    viewport.width = static_cast<float>(extent.width);
+    viewport.height = static_cast<float>(extent.height);
     viewport.minDepth = 0.0f;
     viewport.maxDepth = 1.0f;
     vkCmdSetViewport(buffer, 0, 1, &viewport);
 
     VkRect2D scissor = {};
     scissor.offset = {0, 0};
-    scissor.extent = ctx.Swapchain.extent;
+    scissor.extent = extent;
     vkCmdSetScissor(buffer, 0, 1, &scissor);
 }
 
-void common::SubmitQueue(VkQueue queue, std::span<VkCommandBuffer> buffers, VkFence fence,
-                         std::span<VkSemaphore> waitSemaphores,
-                         std::span<VkPipelineStageFlags> waitStages,
-                         std::span<VkSemaphore> signalSemaphores)
+uint64_t common::SubmitToTimeline(VulkanContext &ctx, VkQueue queue,
+                                  std::span<VkCommandBuffer> buffers,
+                                  std::span<const VkSemaphoreSubmitInfo> waits,
+                                  std::span<const VkSemaphoreSubmitInfo> signals)
 {
-    VkSubmitInfo submitInfo = {};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-
-    submitInfo.commandBufferCount = static_cast<uint32_t>(buffers.size());
-    submitInfo.pCommandBuffers = buffers.data();
+    std::vector<VkCommandBufferSubmitInfo> bufferInfos(buffers.size());
 
-    if (!waitSemaphores.empty())
+    for (size_t i = 0; i < buffers.size(); i++)
     {
-        assert(waitSemaphores.size() == waitStages.size());
-
-        submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
-        submitInfo.pWaitSemaphores = waitSemaphores.data();
-        submitInfo.pWaitDstStageMask = waitStages.data();
+        bufferInfos[i].sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
+        bufferInfos[i].commandBuffer = buffers[i];
     }
 
-    if (!signalSemaphores.empty())
-    {
-        submitInfo.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
-        submitInfo.pSignalSemaphores = signalSemaphores.data();
-    }
+    std::vector<VkSemaphoreSubmitInfo> signalInfos(signals.begin(), signals.end());
+
+    std::lock_guard lock(ctx.QueueMutex);
+
+    auto &timeline = ctx.GraphicsTimeline;
+    uint64_t value = timeline.LastSubmitted + 1;
+
+    signalInfos.push_back(utils::SemaphoreSubmitInfo(
+        timeline.Semaphore, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, value));
+
+    VkSubmitInfo2 submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+    submitInfo.waitSemaphoreInfoCount = static_cast<uint32_t>(waits.size());
+    submitInfo.pWaitSemaphoreInfos = waits.data();
+    submitInfo.commandBufferInfoCount = static_cast<uint32_t>(bufferInfos.size());
+    submitInfo.pCommandBufferInfos = bufferInfos.data();
+    submitInfo.signalSemaphoreInfoCount = static_cast<uint32_t>(signalInfos.size());
+    submitInfo.pSignalSemaphoreInfos = signalInfos.data();
 
-    if (vkQueueSubmit(queue, 1, &submitInfo, fence) != VK_SUCCESS)
+    if (vkQueueSubmit2(queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
     {
         throw std::runtime_error("Failed to submit commands to queue!");
     }
-}
 
-void common::SubmitGraphicsQueueDefault(VkQueue queue, std::span<VkCommandBuffer> buffers,
-                                        VkFence fence, VkSemaphore imageAcquiredSemaphore,
-                                        VkSemaphore renderCompleteSemaphore)
-{
-    std::array<VkSemaphore, 1> waitSemaphores{imageAcquiredSemaphore};
-    std::array<VkPipelineStageFlags, 1> waitStages{
-        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-    std::array<VkSemaphore, 1> signalSemaphores{renderCompleteSemaphore};
+    timeline.LastSubmitted = value;
 
-    common::SubmitQueue(queue, buffers, fence, waitSemaphores, waitStages,
-                        signalSemaphores);
+    return value;
 }
 
 void common::AcquireNextImage(VulkanContext &ctx, VkSemaphore semaphore,
@@ -78,7 +79,11 @@ void common::AcquireNextImage(VulkanContext &ctx, VkSemaphore semaphore,
         {
             ctx.SwapchainOk = false;
         }
-        else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
+        else if (result == VK_SUBOPTIMAL_KHR)
+        {
+            ctx.SwapchainSuboptimal = true;
+        }
+        else if (result != VK_SUCCESS)
         {
             throw std::runtime_error("Failed to acquire swapchain image!");
         }
@@ -99,13 +104,22 @@ void common::PresentFrame(VulkanContext &ctx, VkQueue presentQueue,
     present_info.pSwapchains = swapChains.data();
     present_info.pImageIndices = &frameImageIndex;
 
-    VkResult result = vkQueuePresentKHR(presentQueue, &present_info);
+    VkResult result;
+    {
+        std::lock_guard lock(ctx.QueueMutex);
+        result = vkQueuePresentKHR(presentQueue, &present_info);
+    }
 
-    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
+    if (result == VK_ERROR_OUT_OF_DATE_KHR)
     {
         ctx.SwapchainOk = false;
         return;
     }
+    else if (result == VK_SUBOPTIMAL_KHR)
+    {
+        // Still presentable, recreation can wait for the next resize handling:
+        ctx.SwapchainSuboptimal = true;
+    }
     else if (result != VK_SUCCESS)
     {
         throw std::runtime_error("Failed to present swapchain image!");
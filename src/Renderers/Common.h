@@ -3,20 +3,19 @@
 #include "VulkanContext.h"
 #include <vulkan/vulkan.h>
 
+#include <cstdint>
 #include <span>
 
 namespace common
 {
 void ViewportScissorDefaultBehaviour(VulkanContext &ctx, VkCommandBuffer buffer);
 
-void SubmitQueue(VkQueue queue, std::span<VkCommandBuffer> buffers, VkFence fence,
-                 std::span<VkSemaphore> waitSemaphores,
-                 std::span<VkPipelineStageFlags> waitStages,
-                 std::span<VkSemaphore> signalSemaphores);
-
-void SubmitGraphicsQueueDefault(VkQueue queue, std::span<VkCommandBuffer> buffers,
-                                VkFence fence, VkSemaphore imageAcquiredSemaphore,
-                                VkSemaphore renderCompleteSemaphore);
+// Submits buffers with vkQueueSubmit2, additionally signalling the graphics timeline.
+// Returns the timeline value reached once the submission has finished:
+uint64_t SubmitToTimeline(VulkanContext &ctx, VkQueue queue,
+                          std::span<VkCommandBuffer> buffers,
+                          std::span<const VkSemaphoreSubmitInfo> waits,
+                          std::span<const VkSemaphoreSubmitInfo> signals);
 
 void AcquireNextImage(VulkanContext &ctx, VkSemaphore semaphore, uint32_t &imageIndex);
 
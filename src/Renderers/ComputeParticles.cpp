@@ -6,63 +6,72 @@
 #include "Descriptor.h"
 #include "Shader.h"
 
+#include "Profiler.h"
+
 #include "ImGuiContext.h"
 #include "imgui.h"
 
 #include <cstddef>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
 
+#include <algorithm>
 #include <array>
-#include <random>
+#include <chrono>
+#include <cmath>
+#include <cstring>
 #include <vulkan/vulkan.h>
 
-std::vector<VkVertexInputAttributeDescription> ComputeParticleRenderer::Vertex::
-    getAttributeDescriptions()
-{
-    std::vector<VkVertexInputAttributeDescription> attributeDescriptions{
-        // location, binding, format, offset
-        {0, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(Vertex, Pos)},
-    };
-
-    return attributeDescriptions;
-}
-
 ComputeParticleRenderer::ComputeParticleRenderer(VulkanContext &ctx,
                                                  std::function<void()> callback)
-    : RendererBase(ctx, callback)
+    // Simulation reads the particles written by the previous frame slot,
+    // so it needs at least two of them:
+    : RendererBase(ctx, callback, 2), mCpuSimulator(*ctx.Jobs)
 {
+    InitParticleState();
     CreateDescriptorSets();
-    CreateGraphicsPipelines();
-    CreateComputePipelines();
-    CreateSwapchainResources();
-    CreateVertexBuffers();
+    CreateCommandPools();
     CreateUniformBuffers();
-    UpdateDescriptorSets();
-    CreateSyncObjects();
+    CreateLayoutResources(mCpuState);
+
+    // On software implementations the CPU path is the faster one:
+    mUseCpuBackend =
+        ctx.PhysicalDevice.properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_CPU;
+
+    mEmitters.push_back(Emitter{.Position = glm::vec2(-0.5f, 0.0f)});
+    mEmitters.push_back(Emitter{.Position = glm::vec2(0.5f, 0.0f)});
 }
 
 ComputeParticleRenderer::~ComputeParticleRenderer()
 {
-    mSwapchainDeletionQueue.flush();
-    mMainDeletionQueue.flush();
+    mParticleDeletionQueue.flush(ctx);
+    mSwapchainDeletionQueue.flush(ctx);
+    mMainDeletionQueue.flush(ctx);
 }
 
 void ComputeParticleRenderer::OnUpdate([[maybe_unused]] float deltatime)
 {
-    auto width = static_cast<float>(ctx.Swapchain.extent.width);
-    auto height = static_cast<float>(ctx.Swapchain.extent.height);
+    auto width = static_cast<float>(ctx.GetRenderExtent().width);
+    auto height = static_cast<float>(ctx.GetRenderExtent().height);
 
     float sx = 1.0f, sy = 1.0f;
 
-    if (height < width)
-        sx = width / height;
-    else
-        sy = height / width;
+    // Extent is zero while minimized:
+    if (width > 0.0f && height > 0.0f)
+    {
+        if (height < width)
+            sx = width / height;
+        else
+            sy = height / width;
+    }
 
     auto proj = glm::ortho(-sx, sx, -sy, sy, -1.0f, 1.0f);
 
     mUBOData.MVP = proj;
     mUBOData.DeltaTime = deltatime / 1000.0f;
+    mUBOData.ParticleCount = static_cast<uint32_t>(mParticleCount);
+
+    UpdateEmitters(mUBOData.DeltaTime);
 
     auto &uniformBuffer = mUniformBuffers[mFrameSemaphoreIndex];
     Buffer::UploadToMappedBuffer(uniformBuffer, &mUBOData, sizeof(mUBOData));
@@ -74,122 +83,177 @@ void ComputeParticleRenderer::OnImGui()
     callback();
     ImGui::SliderFloat("Point size", &mUBOData.PointSize, 5.0f, 100.0f);
     ImGui::SliderFloat("Speed", &mUBOData.Speed, 0.0f, 50.0f);
+
+    constexpr std::array<const char *, 3> layoutNames{
+        "Array of structs (std140)", "Struct of arrays (std430)",
+        "Struct of arrays, half velocity"};
+
+    int layout = static_cast<int>(mLayout);
+    if (ImGui::Combo("Layout", &layout, layoutNames.data(),
+                     static_cast<int>(layoutNames.size())))
+        SetLayout(static_cast<ParticleLayout>(layout));
+
+    auto particleBytes = static_cast<size_t>(ParticleStride() + VelocityStride());
+    ImGui::Text("Bytes per particle: %zu", particleBytes);
+    ImGui::Text("Alive particles: %u/%zu", mAliveCount, mParticleCount);
+
+    ImGui::Separator();
+
+    for (size_t i = 0; i < mEmitters.size(); i++)
+    {
+        auto &emitter = mEmitters[i];
+
+        ImGui::PushID(static_cast<int>(i));
+
+        ImGui::Checkbox("Emitter", &emitter.Enabled);
+        ImGui::SliderFloat2("Position", &emitter.Position.x, -1.0f, 1.0f);
+        ImGui::SliderFloat("Rate", &emitter.Rate, 0.0f, 2000.0f);
+        ImGui::SliderFloat("Lifetime", &emitter.Lifetime, 0.1f, 10.0f);
+        ImGui::SliderFloat("Emit speed", &emitter.Speed, 0.0f, 0.05f);
+        ImGui::SliderFloat("Spread", &emitter.Spread, 0.0f, 0.5f);
+
+        ImGui::PopID();
+    }
+
+    if (mEmitters.size() < MAX_EMITTERS && ImGui::Button("Add emitter"))
+        mEmitters.push_back(Emitter{});
+
+    ImGui::Separator();
+
+    bool useCpu = mUseCpuBackend;
+    if (ImGui::Checkbox("Simulate on CPU", &useCpu))
+        SetBackend(useCpu);
+
+    if (mUseCpuBackend)
+        ImGui::Text("CPU step: %.3f ms (%zu threads)", mCpuStepTime,
+                    mCpuSimulator.NumThreads());
+
+    if (ImGui::Button("Validate GPU against CPU"))
+        ValidateBackends();
+
+    if (mValidation.Done)
+        ImGui::Text("Max error: %g, mismatches: %zu/%zu", mValidation.MaxError,
+                    mValidation.Mismatches, mParticleCount);
+
+    ImGui::Separator();
+
+    ImGui::Text("Workgroup size: %u%s", mTuning.WorkgroupSize,
+                mTuning.FromCache ? " (cached)" : "");
+
+    for (auto &timing : mTuning.Timings)
+        ImGui::BulletText("%4u: %.4f ms", timing.WorkgroupSize, timing.Milliseconds);
+
+    if (ImGui::Button("Rerun autotuner"))
+        Retune();
+
     ImGui::End();
 }
 
 void ComputeParticleRenderer::OnRenderImpl()
 {
-    auto &imageAcquiredSemaphore = mImageAcquiredSemaphores[mFrameSemaphoreIndex];
-    auto &renderCompleteSemaphore = mRenderCompletedSemaphores[mFrameSemaphoreIndex];
-    auto &fence = mInFlightFences[mFrameSemaphoreIndex];
+    PROFILE_SCOPE("ComputeParticleRenderer::OnRenderImpl");
 
-    // RunCompute
+    if (mTuning.Pending)
     {
-        auto &buffer = mComputeCommandBuffers[mFrameSemaphoreIndex];
-        auto &computeFence = mComputeInFlightFences[mFrameSemaphoreIndex];
+        // Lets the previous renderer's last frames drain, so the GPU is ours alone:
+        utils::WaitTimelineValue(ctx, ctx.GraphicsTimeline.LastSubmitted);
+        Retune();
+    }
 
-        vkWaitForFences(ctx.Device, 1, &computeFence, VK_TRUE, UINT64_MAX);
+    // Compute overwrites the draw list and counters of this frame,
+    // so previous compute and draw using them need to finish first:
+    BeginFrame();
 
-        vkResetFences(ctx.Device, 1, &computeFence);
+    uint64_t computeValue;
 
-        vkResetCommandBuffer(buffer, 0);
-        RecordComputeCommandBuffer(buffer);
+    // RunCompute
+    {
+        auto buffer = CurrentFrame().AllocateCommandBuffer(ctx);
+        auto &buffers = mParticleBuffers[mFrameSemaphoreIndex];
 
-        auto buffers = std::array<VkCommandBuffer, 1>{buffer};
+        ParticleCounters counters;
+        Buffer::DownloadFromBuffer(ctx, buffers.CountersReadback, &counters,
+                                   sizeof(counters));
+        mAliveCount = counters.AliveCount;
 
-        std::array<VkSemaphore, 1> signalSemaphores{
-            mComputeFinishedSemaphores[mFrameSemaphoreIndex]};
+        if (mUseCpuBackend)
+            StepCpuSimulation();
 
-        common::SubmitQueue(mGraphicsQueue, buffers, computeFence, {}, {},
-                            signalSemaphores);
-    }
+        RecordComputeCommandBuffer(buffer);
 
-    vkWaitForFences(ctx.Device, 1, &fence, VK_TRUE, UINT64_MAX);
+        auto commandBuffers = std::array<VkCommandBuffer, 1>{buffer};
 
-    common::AcquireNextImage(ctx, imageAcquiredSemaphore, mFrameImageIndex);
+        computeValue = SubmitWork(commandBuffers);
+    }
 
-    if (!ctx.SwapchainOk)
+    if (!AcquireFrameImage())
         return;
 
-    vkResetFences(ctx.Device, 1, &fence);
-
     // DrawFrame
     {
-        auto &buffer = mCommandBuffers[mFrameSemaphoreIndex];
+        auto buffer = CurrentFrame().AllocateCommandBuffer(ctx);
 
-        vkResetCommandBuffer(buffer, 0);
         RecordCommandBuffer(buffer, mFrameImageIndex);
 
         auto buffers = std::array<VkCommandBuffer, 1>{buffer};
 
-        std::array<VkSemaphore, 2> waitSemaphores{
-            mComputeFinishedSemaphores[mFrameSemaphoreIndex], imageAcquiredSemaphore};
-
-        std::array<VkPipelineStageFlags, 2> waitStages{
-            VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
-            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-
-        std::array<VkSemaphore, 1> signalSemaphores{renderCompleteSemaphore};
+        // Draw consumes the indirect arguments and particles written by compute:
+        std::array<VkSemaphoreSubmitInfo, 1> waits{utils::SemaphoreSubmitInfo(
+            ctx.GraphicsTimeline.Semaphore,
+            VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT,
+            computeValue)};
 
-        common::SubmitQueue(mGraphicsQueue, buffers, fence, waitSemaphores, waitStages,
-                            signalSemaphores);
+        SubmitFrame(buffers, waits);
     }
 
-    common::PresentFrame(ctx, mPresentQueue, renderCompleteSemaphore, mFrameImageIndex);
-}
-
-void ComputeParticleRenderer::CreateSwapchainResources()
-{
-    CreateCommandPools();
-    CreateCommandBuffers();
+    PresentFrame();
 }
 
 void ComputeParticleRenderer::CreateDescriptorSets()
 {
-    auto numFrames = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+    constexpr auto vertexCompute =
+        VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+    constexpr auto storage = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
 
     // Descriptor layout
+    // 0 - parameters, 1/2 - particles (last/current), 3/4 - lifetimes (last/current)
+    // 5 - alive list, 6 - free list, 7 - counters, 8/9 - velocities (last/current)
+    // In the AoS layout velocities are interleaved with positions,
+    // and bindings 8/9 alias the particle buffers.
     mDescriptorSetLayout =
         DescriptorSetLayoutBuilder()
-            .AddBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-                        VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_COMPUTE_BIT)
-            .AddBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
-            .AddBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+            .AddBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, vertexCompute)
+            .AddBinding(1, storage, VK_SHADER_STAGE_COMPUTE_BIT)
+            .AddBinding(2, storage, vertexCompute)
+            .AddBinding(3, storage, VK_SHADER_STAGE_COMPUTE_BIT)
+            .AddBinding(4, storage, vertexCompute)
+            .AddBinding(5, storage, vertexCompute)
+            .AddBinding(6, storage, VK_SHADER_STAGE_COMPUTE_BIT)
+            .AddBinding(7, storage, VK_SHADER_STAGE_COMPUTE_BIT)
+            .AddBinding(8, storage, VK_SHADER_STAGE_COMPUTE_BIT)
+            .AddBinding(9, storage, VK_SHADER_STAGE_COMPUTE_BIT)
             .Build(ctx);
 
-    // Descriptor pool
-    std::vector<PoolCount> poolCounts{{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, numFrames},
-                                      {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2 * numFrames}};
-    uint32_t maxSets = numFrames;
-
-    mDescriptorPool = Descriptor::InitPool(ctx, maxSets, poolCounts);
-
-    // Descriptor sets allocation
-    std::vector<VkDescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT,
+    // Descriptor sets allocation, one per frame and one for the autotuner:
+    std::vector<VkDescriptorSetLayout> layouts(mFramesInFlight + 1,
                                                mDescriptorSetLayout);
 
-    mDescriptorSets = Descriptor::Allocate(ctx, mDescriptorPool, layouts);
+    mDescriptorSets = mDescriptorAllocator.Allocate(ctx, layouts);
 
-    mMainDeletionQueue.push_back([&]() {
-        vkDestroyDescriptorPool(ctx.Device, mDescriptorPool, nullptr);
-        vkDestroyDescriptorSetLayout(ctx.Device, mDescriptorSetLayout, nullptr);
-    });
+    mTuningDescriptorSet = mDescriptorSets.back();
+    mDescriptorSets.pop_back();
 }
 
 void ComputeParticleRenderer::CreateGraphicsPipelines()
 {
     auto shaderStages = ShaderBuilder()
-                            .SetVertexPath("assets/spirv/ParticleVert.spv")
+                            .SetVertexPath(ShaderPath("Particle", "Vert"))
                             .SetFragmentPath("assets/spirv/ParticleFrag.spv")
                             .Build(ctx);
 
-    auto bindingDescription =
-        utils::GetBindingDescription<Vertex>(0, VK_VERTEX_INPUT_RATE_VERTEX);
-    auto attributeDescriptions = Vertex::getAttributeDescriptions();
-
+    // Particles are pulled from storage buffers in the vertex shader:
     mGraphicsPipeline = PipelineBuilder()
                             .SetShaderStages(shaderStages)
-                            .SetVertexInput(bindingDescription, attributeDescriptions)
                             .SetTopology(VK_PRIMITIVE_TOPOLOGY_POINT_LIST)
                             .SetPolygonMode(VK_POLYGON_MODE_FILL)
                             .SetCullMode(VK_CULL_MODE_BACK_BIT, VK_FRONT_FACE_CLOCKWISE)
@@ -198,85 +262,99 @@ void ComputeParticleRenderer::CreateGraphicsPipelines()
                             .EnableBlending()
                             .Build(ctx, mDescriptorSetLayout);
 
-    mMainDeletionQueue.push_back([&]() {
-        vkDestroyPipeline(ctx.Device, mGraphicsPipeline.Handle, nullptr);
-        vkDestroyPipelineLayout(ctx.Device, mGraphicsPipeline.Layout, nullptr);
-    });
+    mParticleDeletionQueue.push_back(VK_OBJECT_TYPE_PIPELINE, mGraphicsPipeline.Handle);
+    mParticleDeletionQueue.push_back(VK_OBJECT_TYPE_PIPELINE_LAYOUT,
+                                     mGraphicsPipeline.Layout);
 }
 
 void ComputeParticleRenderer::CreateComputePipelines()
 {
-    auto shaderStages =
-        ShaderBuilder().SetComputePath("assets/spirv/ParticleComp.spv").Build(ctx);
+    // Construction runs on the loader thread while the previous renderer is still
+    // rendering, which would skew (and then cache) the measurements. Without
+    // a cached size tuning is deferred to the first frame, see OnRenderImpl:
+    TuneSimulationKernel(false, true);
 
-    mComputePipeline = ComputePipelineBuilder()
-                           .SetShaderStage(shaderStages[0])
-                           .Build(ctx, mDescriptorSetLayout);
+    auto emitStages =
+        ShaderBuilder().SetComputePath(ShaderPath("ParticleEmit", "Comp")).Build(ctx);
 
-    mMainDeletionQueue.push_back([&]() {
+    mEmitPipeline = ComputePipelineBuilder()
+                        .SetShaderStage(emitStages[0])
+                        .Build(ctx, mDescriptorSetLayout);
+
+    // Retuning replaces the simulation pipeline, so this destroys the current one:
+    mParticleDeletionQueue.push_back([&]() {
         vkDestroyPipeline(ctx.Device, mComputePipeline.Handle, nullptr);
         vkDestroyPipelineLayout(ctx.Device, mComputePipeline.Layout, nullptr);
+        vkDestroyPipeline(ctx.Device, mEmitPipeline.Handle, nullptr);
+        vkDestroyPipelineLayout(ctx.Device, mEmitPipeline.Layout, nullptr);
     });
 }
 
-void ComputeParticleRenderer::CreateSyncObjects()
+Pipeline ComputeParticleRenderer::BuildSimulationPipeline(uint32_t workgroupSize)
 {
-    mComputeFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    mComputeInFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
+    auto shaderStages =
+        ShaderBuilder().SetComputePath(ShaderPath("Particle", "Comp")).Build(ctx);
 
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
-    {
-        utils::CreateSemaphore(ctx, mComputeFinishedSemaphores[i]);
-        utils::CreateSignalledFence(ctx, mComputeInFlightFences[i]);
-    }
+    // Constant 0 is local_size_x_id in Particle.comp:
+    return ComputePipelineBuilder()
+        .SetShaderStage(shaderStages[0])
+        .SetSpecialization(SpecializationConstants().Add(0, workgroupSize))
+        .Build(ctx, mDescriptorSetLayout);
+}
 
-    mMainDeletionQueue.push_back([&]() {
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
-        {
-            vkDestroySemaphore(ctx.Device, mComputeFinishedSemaphores[i], nullptr);
-            vkDestroyFence(ctx.Device, mComputeInFlightFences[i], nullptr);
-        }
-    });
+void ComputeParticleRenderer::TuneSimulationKernel(bool ignoreCache, bool cacheOnly)
+{
+    Buffer::UploadToMappedBuffer(mTuningUniformBuffer, &mUBOData, sizeof(mUBOData));
+
+    WorkgroupTuningInfo info{
+        .Name = std::string("Particle") + LayoutSuffix(mLayout) + "Comp",
+        .Candidates = {32, 64, 128, 256, 512, 1024},
+        .Queue = mGraphicsQueue,
+        .Pool = mCommandPool,
+        .BuildPipeline = [this](uint32_t size) { return BuildSimulationPipeline(size); },
+        .RecordDispatch =
+            [this](VkCommandBuffer cmd, const Pipeline &pipeline, uint32_t size) {
+                RecordSimulation(cmd, mTuningBuffers[1], mTuningDescriptorSet, pipeline,
+                                 size);
+            },
+        .IgnoreCache = ignoreCache,
+        .CacheOnly = cacheOnly,
+    };
+
+    mTuning = Autotuner::FindWorkgroupSize(ctx, info);
+    mComputePipeline = BuildSimulationPipeline(mTuning.WorkgroupSize);
+}
+
+void ComputeParticleRenderer::Retune()
+{
+    WaitForFrames();
+
+    vkDestroyPipeline(ctx.Device, mComputePipeline.Handle, nullptr);
+    vkDestroyPipelineLayout(ctx.Device, mComputePipeline.Layout, nullptr);
+
+    TuneSimulationKernel(true);
 }
 
 void ComputeParticleRenderer::CreateCommandPools()
 {
     VkCommandPoolCreateInfo pool_info = {};
     pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-    pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    // Only used for one-off upload commands, frame commands come from FrameContext:
+    pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
     pool_info.queueFamilyIndex =
         ctx.Device.get_queue_index(vkb::QueueType::graphics).value();
 
     if (vkCreateCommandPool(ctx.Device, &pool_info, nullptr, &mCommandPool) != VK_SUCCESS)
         throw std::runtime_error("Failed to create a command pool!");
 
-    mSwapchainDeletionQueue.push_back(
-        [&]() { vkDestroyCommandPool(ctx.Device, mCommandPool, nullptr); });
-}
-
-void ComputeParticleRenderer::CreateCommandBuffers()
-{
-    mCommandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-    mComputeCommandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-
-    VkCommandBufferAllocateInfo allocInfo = {};
-    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.commandPool = mCommandPool;
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandBufferCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
-
-    if (vkAllocateCommandBuffers(ctx.Device, &allocInfo, mCommandBuffers.data()) !=
-        VK_SUCCESS)
-        throw std::runtime_error("Failed to allocate command buffers!");
-
-    if (vkAllocateCommandBuffers(ctx.Device, &allocInfo, mComputeCommandBuffers.data()) !=
-        VK_SUCCESS)
-        throw std::runtime_error("Failed to allocate command buffers!");
+    mMainDeletionQueue.push_back(VK_OBJECT_TYPE_COMMAND_POOL, mCommandPool);
 }
 
 void ComputeParticleRenderer::RecordCommandBuffer(VkCommandBuffer commandBuffer,
                                                   uint32_t imageIndex)
 {
+    PROFILE_SCOPE("ComputeParticleRenderer::RecordCommandBuffer");
+
     VkCommandBufferBeginInfo begin_info = {};
     begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 
@@ -308,18 +386,23 @@ void ComputeParticleRenderer::RecordCommandBuffer(VkCommandBuffer commandBuffer,
 
         common::ViewportScissorDefaultBehaviour(ctx, commandBuffer);
 
-        std::array<VkBuffer, 1> vertexBuffers{
-            mVertexBuffers[mFrameSemaphoreIndex].Handle};
-        std::array<VkDeviceSize, 1> offsets{0};
-        vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers.data(), offsets.data());
-
         vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
                                 mGraphicsPipeline.Layout, 0, 1,
                                 &mDescriptorSets[mFrameSemaphoreIndex], 0, nullptr);
 
-        vkCmdDraw(commandBuffer, static_cast<uint32_t>(mVertexCount), 1, 0, 0);
+        {
+            GpuZone zone(mGpuProfiler, commandBuffer, "Particles draw", true);
+
+            // Vertex count is the alive counter written by the compute pass:
+            vkCmdDrawIndirect(commandBuffer,
+                              mParticleBuffers[mFrameSemaphoreIndex].Counters.Handle, 0,
+                              1, sizeof(VkDrawIndirectCommand));
+        }
 
-        ImGuiContextManager::RecordImguiToCommandBuffer(commandBuffer);
+        {
+            GpuZone zone(mGpuProfiler, commandBuffer, "ImGui");
+            ImGuiContextManager::RecordImguiToCommandBuffer(commandBuffer);
+        }
     }
     vkCmdEndRendering(commandBuffer);
 
@@ -331,132 +414,735 @@ void ComputeParticleRenderer::RecordCommandBuffer(VkCommandBuffer commandBuffer,
 
 void ComputeParticleRenderer::RecordComputeCommandBuffer(VkCommandBuffer commandBuffer)
 {
+    PROFILE_SCOPE("ComputeParticleRenderer::RecordComputeCommandBuffer");
+
     VkCommandBufferBeginInfo begin_info = {};
     begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 
     if (vkBeginCommandBuffer(commandBuffer, &begin_info) != VK_SUCCESS)
         throw std::runtime_error("Failed to begin recording command buffer!");
 
-    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
-                      mComputePipeline.Handle);
-    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
-                            mComputePipeline.Layout, 0, 1,
-                            &mDescriptorSets[mFrameSemaphoreIndex], 0, 0);
+    auto &buffers = mParticleBuffers[mFrameSemaphoreIndex];
+
+    auto zone = mGpuProfiler.BeginGpuZone(commandBuffer, "Particles update", true);
+
+    if (mUseCpuBackend)
+    {
+        // Particles were already advanced on the CPU, only upload the results:
+        const auto &layout = mStagingLayout;
+
+        auto copy = [&](VkBuffer dst, VkDeviceSize offset, VkDeviceSize size) {
+            VkBufferCopy copyRegion{};
+            copyRegion.srcOffset = mCpuUpload.Offset + offset;
+            copyRegion.size = size;
+
+            vkCmdCopyBuffer(commandBuffer, mCpuUpload.Buffer, dst, 1, &copyRegion);
+        };
+
+        copy(buffers.Particles.Handle, layout.Particles,
+             layout.Velocities - layout.Particles);
 
-    vkCmdDispatch(commandBuffer, static_cast<uint32_t>(mVertexCount) / 256, 1, 1);
+        if (mLayout != ParticleLayout::AoS)
+            copy(buffers.Velocities.Handle, layout.Velocities,
+                 layout.Life - layout.Velocities);
+
+        copy(buffers.Life.Handle, layout.Life, layout.Alive - layout.Life);
+        copy(buffers.Alive.Handle, layout.Alive, layout.Counters - layout.Alive);
+        copy(buffers.Counters.Handle, layout.Counters, sizeof(ParticleCounters));
+    }
+    else
+    {
+        RecordDispatch(commandBuffer, mFrameSemaphoreIndex, mUBOData.EmitCount);
+    }
+
+    mGpuProfiler.EndGpuZone(commandBuffer, zone);
+
+    // Copy the counters, so that alive count can be displayed without stalling:
+    utils::InsertMemoryBarrier(commandBuffer,
+                               {
+                                   .SrcAccessMask = VK_ACCESS_SHADER_WRITE_BIT |
+                                                    VK_ACCESS_TRANSFER_WRITE_BIT,
+                                   .DstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+                                   .SrcStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT |
+                                                   VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                   .DstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT,
+                               });
+
+    VkBufferCopy copyRegion{};
+    copyRegion.size = sizeof(ParticleCounters);
+
+    vkCmdCopyBuffer(commandBuffer, buffers.Counters.Handle,
+                    buffers.CountersReadback.Handle, 1, &copyRegion);
+
+    utils::InsertMemoryBarrier(commandBuffer,
+                               {
+                                   .SrcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+                                   .DstAccessMask = VK_ACCESS_HOST_READ_BIT,
+                                   .SrcStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                   .DstStageMask = VK_PIPELINE_STAGE_HOST_BIT,
+                               });
 
     if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
         throw std::runtime_error("Failed to record command buffer!");
 }
 
-void ComputeParticleRenderer::CreateVertexBuffers()
+void ComputeParticleRenderer::RecordDispatch(VkCommandBuffer commandBuffer,
+                                             size_t frameIndex, uint32_t emitCount)
+{
+    RecordSimulation(commandBuffer, mParticleBuffers[frameIndex],
+                     mDescriptorSets[frameIndex], mComputePipeline,
+                     mTuning.WorkgroupSize);
+
+    if (emitCount == 0)
+        return;
+
+    utils::InsertMemoryBarrier(
+        commandBuffer,
+        {
+            .SrcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+            .DstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+            .SrcStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            .DstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        });
+
+    // Emission, new particles take slots from the free list:
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                      mEmitPipeline.Handle);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                            mEmitPipeline.Layout, 0, 1, &mDescriptorSets[frameIndex], 0,
+                            0);
+
+    vkCmdDispatch(commandBuffer, (emitCount + 63) / 64, 1, 1);
+}
+
+void ComputeParticleRenderer::RecordSimulation(VkCommandBuffer commandBuffer,
+                                               const ParticleBuffers &buffers,
+                                               VkDescriptorSet descriptorSet,
+                                               const Pipeline &pipeline,
+                                               uint32_t workgroupSize)
+{
+    // Counters may still be in use by the previous run on the same buffers
+    // (back-to-back autotuner dispatches, or an earlier submission):
+    utils::InsertMemoryBarrier(
+        commandBuffer,
+        {
+            .SrcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT,
+            .DstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .SrcStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT |
+                            VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT |
+                            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            .DstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT,
+        });
+
+    // Reset alive/free counters, and fill in the constant part of the
+    // indirect draw command:
+    ParticleCounters counters{};
+    vkCmdUpdateBuffer(commandBuffer, buffers.Counters.Handle, 0, sizeof(counters),
+                      &counters);
+
+    // Also covers writes to the last frame's buffers from previous submissions:
+    utils::InsertMemoryBarrier(
+        commandBuffer,
+        {
+            .SrcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT,
+            .DstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+            .SrcStageMask =
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+            .DstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        });
+
+    // Simulation, dead particles are pushed to the free list:
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.Handle);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                            pipeline.Layout, 0, 1, &descriptorSet, 0, 0);
+
+    // Kernel guards against the tail, so the group count is rounded up:
+    auto particleCount = static_cast<uint32_t>(mParticleCount);
+    vkCmdDispatch(commandBuffer, (particleCount + workgroupSize - 1) / workgroupSize, 1,
+                  1);
+}
+
+void ComputeParticleRenderer::InitParticleState()
 {
-    constexpr size_t particleCount = 512;
+    constexpr size_t initialCount = 512;
 
-    std::vector<Vertex> vertices(particleCount);
+    mParticleCount = MAX_PARTICLES;
 
     std::random_device rd;
-    std::mt19937 gen(rd());
+    mCpuRng.seed(rd());
+
     std::uniform_real_distribution<float> dis(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> lifeDis(0.5f, 6.0f);
+
+    // Remaining slots start dead (zero lifetime):
+    mCpuState.Resize(mParticleCount);
 
-    for (size_t i = 0; i < particleCount; i++)
+    for (size_t i = 0; i < initialCount; i++)
     {
-        vertices[i].Pos.x = dis(gen);
-        vertices[i].Pos.y = dis(gen);
+        mCpuState.PosX[i] = dis(mCpuRng);
+        mCpuState.PosY[i] = dis(mCpuRng);
+
+        float theta = 3.1415f * dis(mCpuRng);
+        mCpuState.VelX[i] = 0.01f * std::cos(theta);
+        mCpuState.VelY[i] = 0.01f * std::sin(theta);
 
-        float theta = 3.1415f * dis(gen);
-        vertices[i].Velocity.x = 0.01f * std::cos(theta);
-        vertices[i].Velocity.y = 0.01f * std::sin(theta);
+        mCpuState.Life[i] = lifeDis(mCpuRng);
     }
+}
+
+void ComputeParticleRenderer::CreateLayoutResources(const ParticleState &state)
+{
+    CreateParticleBuffers(state);
+    UpdateDescriptorSets();
+    CreateGraphicsPipelines();
+    // Autotuning runs the kernel, so it needs all buffers in place:
+    CreateComputePipelines();
+}
 
-    mVertexCount = vertices.size();
+void ComputeParticleRenderer::SetLayout(ParticleLayout layout)
+{
+    if (layout == mLayout)
+        return;
 
-    mVertexBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+    WaitForFrames();
 
-    for (auto &buffer : mVertexBuffers)
-    {
+    auto lastFrame =
+        (mFrameSemaphoreIndex + mFramesInFlight - 1) % mFramesInFlight;
+
+    // Decoded with the old layout, re-encoded with the new one:
+    ParticleState state = ReadbackParticles(lastFrame);
+
+    mParticleDeletionQueue.flush(ctx);
+
+    mLayout = layout;
+    CreateLayoutResources(state);
+
+    mCpuState = std::move(state);
+}
+
+void ComputeParticleRenderer::CreateParticleBuffers(const ParticleState &state)
+{
+    const VkDeviceSize particlesSize = mParticleCount * ParticleStride();
+    const VkDeviceSize velocitiesSize = mParticleCount * VelocityStride();
+    const VkDeviceSize indicesSize = mParticleCount * sizeof(uint32_t);
+    const VkDeviceSize lifeSize = mParticleCount * sizeof(float);
+
+    std::vector<std::byte> particles(particlesSize);
+    std::vector<std::byte> velocities(velocitiesSize);
+    PackParticles(state, particles.data(), velocities.data());
+
+    constexpr auto storageUsage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+                                  VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                                  VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+
+    auto createStorage = [&](const void *data, VkDeviceSize size) {
         GPUBufferInfo info{
             .Queue = mGraphicsQueue,
             .Pool = mCommandPool,
-            .Data = vertices.data(),
-            .Size = mVertexCount * sizeof(Vertex),
-            .Usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT |
-                     VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
-                     VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            .Data = data,
+            .Size = size,
+            .Usage = storageUsage,
             .Properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            .MemoryPool = mMemoryPools.Geometry,
         };
 
-        buffer = Buffer::CreateGPUBuffer(ctx, info);
+        return Buffer::CreateGPUBuffer(ctx, info);
+    };
+
+    auto createSet = [&](ParticleBuffers &buffers) {
+        // Drops handles left over from a previous layout (already destroyed):
+        buffers = {};
+
+        buffers.Particles = createStorage(particles.data(), particlesSize);
+        buffers.Life = createStorage(state.Life.data(), lifeSize);
+
+        if (mLayout != ParticleLayout::AoS)
+            buffers.Velocities = createStorage(velocities.data(), velocitiesSize);
+
+        // Lists and counters are fully rewritten every frame, no upload needed:
+        buffers.Alive = Buffer::CreateBuffer(ctx, indicesSize, storageUsage, 0,
+                                             mMemoryPools.Geometry);
+        buffers.Free = Buffer::CreateBuffer(ctx, indicesSize, storageUsage, 0,
+                                            mMemoryPools.Geometry);
+        buffers.Counters =
+            Buffer::CreateBuffer(ctx, sizeof(ParticleCounters),
+                                 storageUsage | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, 0,
+                                 mMemoryPools.Geometry);
+
+        buffers.CountersReadback =
+            Buffer::CreateReadbackBuffer(ctx, sizeof(ParticleCounters));
+
+        ParticleCounters counters{};
+        Buffer::UploadToBuffer(ctx, buffers.CountersReadback, &counters,
+                               sizeof(counters));
+
+        for (auto *buffer : {&buffers.Particles, &buffers.Velocities, &buffers.Life,
+                             &buffers.Alive, &buffers.Free, &buffers.Counters,
+                             &buffers.CountersReadback})
+        {
+            mParticleDeletionQueue.push_back(VK_OBJECT_TYPE_BUFFER, buffer->Handle,
+                                             buffer->Allocation);
+        }
+    };
+
+    mParticleBuffers.clear();
+    mParticleBuffers.resize(mFramesInFlight);
+
+    for (auto &buffers : mParticleBuffers)
+        createSet(buffers);
+
+    // Seeded with the same state, so tuning sees a representative workload:
+    for (auto &buffers : mTuningBuffers)
+        createSet(buffers);
+
+    // Layout of the per-frame uploads of CPU backend results:
+    mStagingLayout.Particles = 0;
+    mStagingLayout.Velocities = particlesSize;
+    mStagingLayout.Life = mStagingLayout.Velocities + velocitiesSize;
+    mStagingLayout.Alive = mStagingLayout.Life + lifeSize;
+    mStagingLayout.Counters = mStagingLayout.Alive + indicesSize;
+    mStagingLayout.Size = mStagingLayout.Counters + sizeof(ParticleCounters);
+}
+
+VkDeviceSize ComputeParticleRenderer::ParticleStride() const
+{
+    // AoS keeps the whole particle in one std140 struct:
+    if (mLayout == ParticleLayout::AoS)
+        return sizeof(Particle);
+
+    return sizeof(glm::vec2);
+}
+
+VkDeviceSize ComputeParticleRenderer::VelocityStride() const
+{
+    switch (mLayout)
+    {
+    case ParticleLayout::SoA:
+        return sizeof(glm::vec2);
+    case ParticleLayout::SoAHalf:
+        return sizeof(uint32_t);
+    default:
+        return 0;
     }
+}
 
-    mMainDeletionQueue.push_back([&]() {
-        for (auto &buffer : mVertexBuffers)
-            Buffer::DestroyBuffer(ctx, buffer);
-    });
+const char *ComputeParticleRenderer::LayoutSuffix(ParticleLayout layout)
+{
+    switch (layout)
+    {
+    case ParticleLayout::SoA:
+        return "SoA";
+    case ParticleLayout::SoAHalf:
+        return "SoAHalf";
+    default:
+        return "";
+    }
+}
+
+std::string ComputeParticleRenderer::ShaderPath(std::string_view name,
+                                                std::string_view stage) const
+{
+    // Variants are generated by scripts/CompileShaders.py:
+    return "assets/spirv/" + std::string(name) + LayoutSuffix(mLayout) +
+           std::string(stage) + ".spv";
+}
+
+void ComputeParticleRenderer::PackParticles(const ParticleState &state,
+                                            std::byte *particles,
+                                            std::byte *velocities) const
+{
+    if (mLayout == ParticleLayout::AoS)
+    {
+        auto dst = reinterpret_cast<Particle *>(particles);
+
+        for (size_t i = 0; i < mParticleCount; i++)
+        {
+            dst[i].Pos = glm::vec2(state.PosX[i], state.PosY[i]);
+            dst[i].Velocity = glm::vec2(state.VelX[i], state.VelY[i]);
+        }
+
+        return;
+    }
+
+    auto pos = reinterpret_cast<glm::vec2 *>(particles);
+
+    for (size_t i = 0; i < mParticleCount; i++)
+        pos[i] = glm::vec2(state.PosX[i], state.PosY[i]);
+
+    if (mLayout == ParticleLayout::SoAHalf)
+    {
+        auto vel = reinterpret_cast<uint32_t *>(velocities);
+
+        for (size_t i = 0; i < mParticleCount; i++)
+            vel[i] = glm::packHalf2x16(glm::vec2(state.VelX[i], state.VelY[i]));
+    }
+    else
+    {
+        auto vel = reinterpret_cast<glm::vec2 *>(velocities);
+
+        for (size_t i = 0; i < mParticleCount; i++)
+            vel[i] = glm::vec2(state.VelX[i], state.VelY[i]);
+    }
+}
+
+void ComputeParticleRenderer::UnpackParticles(ParticleState &state,
+                                              const std::byte *particles,
+                                              const std::byte *velocities) const
+{
+    if (mLayout == ParticleLayout::AoS)
+    {
+        auto src = reinterpret_cast<const Particle *>(particles);
+
+        for (size_t i = 0; i < mParticleCount; i++)
+        {
+            state.PosX[i] = src[i].Pos.x;
+            state.PosY[i] = src[i].Pos.y;
+            state.VelX[i] = src[i].Velocity.x;
+            state.VelY[i] = src[i].Velocity.y;
+        }
+
+        return;
+    }
+
+    auto pos = reinterpret_cast<const glm::vec2 *>(particles);
+
+    for (size_t i = 0; i < mParticleCount; i++)
+    {
+        state.PosX[i] = pos[i].x;
+        state.PosY[i] = pos[i].y;
+    }
+
+    for (size_t i = 0; i < mParticleCount; i++)
+    {
+        glm::vec2 vel;
+
+        if (mLayout == ParticleLayout::SoAHalf)
+            vel = glm::unpackHalf2x16(reinterpret_cast<const uint32_t *>(velocities)[i]);
+        else
+            vel = reinterpret_cast<const glm::vec2 *>(velocities)[i];
+
+        state.VelX[i] = vel.x;
+        state.VelY[i] = vel.y;
+    }
 }
 
 void ComputeParticleRenderer::CreateUniformBuffers()
 {
     VkDeviceSize bufferSize = sizeof(UniformBufferObject);
 
-    mUniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+    mUniformBuffers.resize(mFramesInFlight);
+
+    // Initial contents are needed for the autotuner runs:
+    mUBOData.ParticleCount = static_cast<uint32_t>(mParticleCount);
 
     for (auto &uniformBuffer : mUniformBuffers)
+    {
         uniformBuffer = Buffer::CreateMappedUniformBuffer(ctx, bufferSize);
+        Buffer::UploadToMappedBuffer(uniformBuffer, &mUBOData, sizeof(mUBOData));
 
-    mMainDeletionQueue.push_back([&]() {
-        for (auto &uniformBuffer : mUniformBuffers)
-            Buffer::DestroyBuffer(ctx, uniformBuffer);
-    });
+        mMainDeletionQueue.push_back(VK_OBJECT_TYPE_BUFFER, uniformBuffer.Handle,
+                                     uniformBuffer.Allocation);
+    }
+
+    mTuningUniformBuffer = Buffer::CreateMappedUniformBuffer(ctx, bufferSize);
+    mMainDeletionQueue.push_back(VK_OBJECT_TYPE_BUFFER, mTuningUniformBuffer.Handle,
+                                 mTuningUniformBuffer.Allocation);
 }
 
 void ComputeParticleRenderer::UpdateDescriptorSets()
 {
     for (size_t i = 0; i < mDescriptorSets.size(); i++)
     {
-        VkDescriptorBufferInfo bufferInfo{};
-        bufferInfo.buffer = mUniformBuffers[i].Handle;
-        bufferInfo.offset = 0;
-        bufferInfo.range = sizeof(UniformBufferObject);
-
-        std::array<VkWriteDescriptorSet, 3> descriptorWrites{};
-
-        descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptorWrites[0].dstSet = mDescriptorSets[i];
-        descriptorWrites[0].dstBinding = 0;
-        descriptorWrites[0].dstArrayElement = 0;
-        descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        descriptorWrites[0].descriptorCount = 1;
-        descriptorWrites[0].pBufferInfo = &bufferInfo;
-
-        VkDescriptorBufferInfo storageBufferInfoLastFrame{};
-        storageBufferInfoLastFrame.buffer =
-            mVertexBuffers[(i - 1) % MAX_FRAMES_IN_FLIGHT].Handle;
-        storageBufferInfoLastFrame.offset = 0;
-        storageBufferInfoLastFrame.range = sizeof(Vertex) * mVertexCount;
-
-        descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptorWrites[1].dstSet = mDescriptorSets[i];
-        descriptorWrites[1].dstBinding = 1;
-        descriptorWrites[1].dstArrayElement = 0;
-        descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-        descriptorWrites[1].descriptorCount = 1;
-        descriptorWrites[1].pBufferInfo = &storageBufferInfoLastFrame;
-
-        VkDescriptorBufferInfo storageBufferInfoCurrentFrame{};
-        storageBufferInfoCurrentFrame.buffer = mVertexBuffers[i].Handle;
-        storageBufferInfoCurrentFrame.offset = 0;
-        storageBufferInfoCurrentFrame.range = sizeof(Vertex) * mVertexCount;
-
-        descriptorWrites[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptorWrites[2].dstSet = mDescriptorSets[i];
-        descriptorWrites[2].dstBinding = 2;
-        descriptorWrites[2].dstArrayElement = 0;
-        descriptorWrites[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-        descriptorWrites[2].descriptorCount = 1;
-        descriptorWrites[2].pBufferInfo = &storageBufferInfoCurrentFrame;
-
-        vkUpdateDescriptorSets(ctx.Device, static_cast<uint32_t>(descriptorWrites.size()),
-                               descriptorWrites.data(), 0, nullptr);
+        auto &current = mParticleBuffers[i];
+        auto &last =
+            mParticleBuffers[(i + mFramesInFlight - 1) % mFramesInFlight];
+
+        WriteDescriptorSet(mDescriptorSets[i], mUniformBuffers[i], last, current);
+    }
+
+    WriteDescriptorSet(mTuningDescriptorSet, mTuningUniformBuffer, mTuningBuffers[0],
+                       mTuningBuffers[1]);
+}
+
+void ComputeParticleRenderer::WriteDescriptorSet(VkDescriptorSet set,
+                                                 const Buffer &uniformBuffer,
+                                                 const ParticleBuffers &last,
+                                                 const ParticleBuffers &current)
+{
+    VkDescriptorBufferInfo uniformInfo{};
+    uniformInfo.buffer = uniformBuffer.Handle;
+    uniformInfo.offset = 0;
+    uniformInfo.range = sizeof(UniformBufferObject);
+
+    // Unused by AoS shaders, but descriptors still need to be valid:
+    bool aos = mLayout == ParticleLayout::AoS;
+    VkBuffer lastVelocities = aos ? last.Particles.Handle : last.Velocities.Handle;
+    VkBuffer currentVelocities =
+        aos ? current.Particles.Handle : current.Velocities.Handle;
+
+    // Indexed by binding - 1:
+    std::array<VkDescriptorBufferInfo, 9> storageInfos{{
+        {last.Particles.Handle, 0, VK_WHOLE_SIZE},
+        {current.Particles.Handle, 0, VK_WHOLE_SIZE},
+        {last.Life.Handle, 0, VK_WHOLE_SIZE},
+        {current.Life.Handle, 0, VK_WHOLE_SIZE},
+        {current.Alive.Handle, 0, VK_WHOLE_SIZE},
+        {current.Free.Handle, 0, VK_WHOLE_SIZE},
+        {current.Counters.Handle, 0, VK_WHOLE_SIZE},
+        {lastVelocities, 0, VK_WHOLE_SIZE},
+        {currentVelocities, 0, VK_WHOLE_SIZE},
+    }};
+
+    std::array<VkWriteDescriptorSet, 10> descriptorWrites{};
+
+    descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrites[0].dstSet = set;
+    descriptorWrites[0].dstBinding = 0;
+    descriptorWrites[0].dstArrayElement = 0;
+    descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    descriptorWrites[0].descriptorCount = 1;
+    descriptorWrites[0].pBufferInfo = &uniformInfo;
+
+    for (size_t binding = 1; binding < descriptorWrites.size(); binding++)
+    {
+        auto &write = descriptorWrites[binding];
+
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = set;
+        write.dstBinding = static_cast<uint32_t>(binding);
+        write.dstArrayElement = 0;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        write.descriptorCount = 1;
+        write.pBufferInfo = &storageInfos[binding - 1];
+    }
+
+    vkUpdateDescriptorSets(ctx.Device, static_cast<uint32_t>(descriptorWrites.size()),
+                           descriptorWrites.data(), 0, nullptr);
+}
+
+void ComputeParticleRenderer::UpdateEmitters(float deltaTime)
+{
+    uint32_t emitterCount = 0;
+    uint32_t spawnOffset = 0;
+
+    for (auto &emitter : mEmitters)
+    {
+        if (!emitter.Enabled)
+            continue;
+
+        // Fractional spawns are carried over to the next frame:
+        emitter.Accumulator += emitter.Rate * deltaTime;
+        auto spawnCount = static_cast<uint32_t>(emitter.Accumulator);
+        emitter.Accumulator -= static_cast<float>(spawnCount);
+
+        // Long frames (e.g. when the window is dragged) shouldn't spawn bursts
+        // bigger than the whole pool:
+        spawnCount = std::min(spawnCount, static_cast<uint32_t>(mParticleCount));
+
+        mUBOData.Emitters[emitterCount++] = EmitterData{
+            .Position = emitter.Position,
+            .Spread = emitter.Spread,
+            .Speed = emitter.Speed,
+            .Lifetime = emitter.Lifetime,
+            .SpawnCount = spawnCount,
+            .SpawnOffset = spawnOffset,
+        };
+
+        spawnOffset += spawnCount;
+    }
+
+    mUBOData.EmitterCount = emitterCount;
+    mUBOData.EmitCount = spawnOffset;
+    mUBOData.Seed = mCpuRng();
+}
+
+void ComputeParticleRenderer::StepCpuSimulation()
+{
+    using ms = std::chrono::duration<float, std::milli>;
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    mCpuSimulator.Step(mCpuState, mUBOData.Speed, mUBOData.DeltaTime);
+    EmitCpuParticles();
+
+    auto end = std::chrono::high_resolution_clock::now();
+    mCpuStepTime = std::chrono::duration_cast<ms>(end - start).count();
+
+    // Pack into the layouts expected by the storage buffers:
+    // Sized for the current layout, so it can't be kept across layout changes:
+    mCpuUpload = CurrentFrame().AllocateUpload(ctx, mStagingLayout.Size);
+    auto data = mCpuUpload.Data;
+
+    PackParticles(mCpuState, data + mStagingLayout.Particles,
+                  data + mStagingLayout.Velocities);
+
+    auto life = reinterpret_cast<float *>(data + mStagingLayout.Life);
+    auto alive = reinterpret_cast<uint32_t *>(data + mStagingLayout.Alive);
+
+    ParticleCounters counters{};
+
+    for (size_t i = 0; i < mParticleCount; i++)
+    {
+        life[i] = mCpuState.Life[i];
+
+        if (life[i] > 0.0f)
+            alive[counters.AliveCount++] = static_cast<uint32_t>(i);
+    }
+
+    counters.FreeCount = static_cast<int32_t>(mParticleCount - counters.AliveCount);
+
+    std::memcpy(data + mStagingLayout.Counters, &counters, sizeof(counters));
+
+    CurrentFrame().FlushUploads(ctx);
+}
+
+void ComputeParticleRenderer::EmitCpuParticles()
+{
+    // Same scheme as in ParticleEmit.comp, but with a serial free list:
+    mCpuFreeList.clear();
+
+    for (size_t i = 0; i < mParticleCount; i++)
+    {
+        if (mCpuState.Life[i] <= 0.0f)
+            mCpuFreeList.push_back(static_cast<uint32_t>(i));
+    }
+
+    std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+
+    for (uint32_t e = 0; e < mUBOData.EmitterCount; e++)
+    {
+        const auto &emitter = mUBOData.Emitters[e];
+
+        for (uint32_t i = 0; i < emitter.SpawnCount && !mCpuFreeList.empty(); i++)
+        {
+            uint32_t idx = mCpuFreeList.back();
+            mCpuFreeList.pop_back();
+
+            float r = emitter.Spread * std::sqrt(dis(mCpuRng));
+            float phi = 6.2831853f * dis(mCpuRng);
+            float theta = 6.2831853f * dis(mCpuRng);
+
+            mCpuState.PosX[idx] = emitter.Position.x + r * std::cos(phi);
+            mCpuState.PosY[idx] = emitter.Position.y + r * std::sin(phi);
+            mCpuState.VelX[idx] = emitter.Speed * std::cos(theta);
+            mCpuState.VelY[idx] = emitter.Speed * std::sin(theta);
+            mCpuState.Life[idx] = emitter.Lifetime;
+        }
+    }
+}
+
+void ComputeParticleRenderer::SetBackend(bool useCpu)
+{
+    if (useCpu == mUseCpuBackend)
+        return;
+
+    // When moving to the CPU, simulation needs to continue from the
+    // latest GPU results. In the other direction nothing needs to be done,
+    // since last frame buffers already contain data uploaded from the CPU,
+    // and the GPU rebuilds its lists from lifetimes every frame.
+    if (useCpu)
+    {
+        WaitForFrames();
+
+        auto lastFrame = (mFrameSemaphoreIndex + mFramesInFlight - 1) %
+                         mFramesInFlight;
+        mCpuState = ReadbackParticles(lastFrame);
+    }
+
+    mUseCpuBackend = useCpu;
+}
+
+ParticleState ComputeParticleRenderer::ReadbackParticles(size_t frameIndex)
+{
+    auto &buffers = mParticleBuffers[frameIndex];
+
+    auto download = [&](VkBuffer src, void *dst, VkDeviceSize size) {
+        Buffer readback = Buffer::CreateReadbackBuffer(ctx, size);
+
+        CopyBufferInfo info{
+            .Queue = mGraphicsQueue,
+            .Pool = mCommandPool,
+            .Src = src,
+            .Dst = readback.Handle,
+            .Size = size,
+        };
+
+        Buffer::CopyBuffer(ctx, info);
+        Buffer::DownloadFromBuffer(ctx, readback, dst, size);
+        Buffer::DestroyBuffer(ctx, readback);
+    };
+
+    ParticleState state;
+    state.Resize(mParticleCount);
+
+    std::vector<std::byte> particles(mParticleCount * ParticleStride());
+    std::vector<std::byte> velocities(mParticleCount * VelocityStride());
+
+    download(buffers.Particles.Handle, particles.data(), particles.size());
+    download(buffers.Life.Handle, state.Life.data(), mParticleCount * sizeof(float));
+
+    if (!velocities.empty())
+        download(buffers.Velocities.Handle, velocities.data(), velocities.size());
+
+    UnpackParticles(state, particles.data(), velocities.data());
+
+    return state;
+}
+
+void ComputeParticleRenderer::ValidateBackends()
+{
+    // Runs a single GPU step with a fixed timestep, starting from the latest
+    // simulation state, and compares it against the CPU reference.
+    // Emission is random, so it is disabled for the comparison.
+    constexpr float timestep = 1.0f / 60.0f;
+    constexpr float tolerance = 1e-5f;
+
+    WaitForFrames();
+
+    auto frame = mFrameSemaphoreIndex;
+    auto lastFrame = (frame + mFramesInFlight - 1) % mFramesInFlight;
+
+    ParticleState expected = ReadbackParticles(lastFrame);
+
+    UniformBufferObject ubo = mUBOData;
+    ubo.DeltaTime = timestep;
+    ubo.EmitCount = 0;
+    Buffer::UploadToMappedBuffer(mUniformBuffers[frame], &ubo, sizeof(ubo));
+
+    {
+        utils::ScopedCommand cmd(ctx, mGraphicsQueue, mCommandPool);
+        RecordDispatch(cmd.Buffer, frame, 0);
+    }
+
+    ParticleState result = ReadbackParticles(frame);
+
+    // Restore uniforms of the current frame:
+    Buffer::UploadToMappedBuffer(mUniformBuffers[frame], &mUBOData, sizeof(mUBOData));
+
+    mCpuSimulator.Step(expected, ubo.Speed, ubo.DeltaTime);
+
+    // Positions are compared modulo the period of the domain, since
+    // wrapping may happen on only one side due to rounding:
+    auto periodicDistance = [](float a, float b) {
+        float d = std::abs(a - b);
+        return std::min(d, std::abs(2.0f - d));
+    };
+
+    mValidation = ValidationResult{.Done = true};
+
+    for (size_t i = 0; i < mParticleCount; i++)
+    {
+        float error = std::max({
+            periodicDistance(expected.PosX[i], result.PosX[i]),
+            periodicDistance(expected.PosY[i], result.PosY[i]),
+            std::abs(expected.VelX[i] - result.VelX[i]),
+            std::abs(expected.VelY[i] - result.VelY[i]),
+            std::abs(expected.Life[i] - result.Life[i]),
+        });
+
+        mValidation.MaxError = std::max(mValidation.MaxError, error);
+
+        if (error > tolerance)
+            mValidation.Mismatches++;
     }
 }
\ No newline at end of file
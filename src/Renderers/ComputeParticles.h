@@ -2,12 +2,28 @@
 
 #include "RendererBase.h"
 
+#include "Autotuner.h"
 #include "Buffer.h"
+#include "ParticleSimulator.h"
 #include "Pipeline.h"
 
 #include <glm/glm.hpp>
 #include <vulkan/vulkan.h>
 
+#include <array>
+#include <cstddef>
+#include <random>
+#include <string>
+#include <string_view>
+
+/// Storage layout of particle state in GPU buffers.
+enum class ParticleLayout
+{
+    AoS,
+    SoA,
+    SoAHalf,
+};
+
 class ComputeParticleRenderer : public RendererBase {
   public:
     ComputeParticleRenderer(VulkanContext &ctx, std::function<void()> callback);
@@ -19,57 +35,173 @@ class ComputeParticleRenderer : public RendererBase {
     void OnRenderImpl() override;
 
   private:
-    void CreateSwapchainResources() override;
+    struct ParticleBuffers {
+        // Interleaved particles in AoS layout, positions only otherwise:
+        Buffer Particles;
+        Buffer Velocities;
+        Buffer Life;
+        Buffer Alive;
+        Buffer Free;
+        Buffer Counters;
+        // Host visible copy of the counters, read once the frame is done:
+        Buffer CountersReadback;
+    };
 
-  private:
     void CreateDescriptorSets();
     void UpdateDescriptorSets();
+    void WriteDescriptorSet(VkDescriptorSet set, const Buffer &uniformBuffer,
+                            const ParticleBuffers &last, const ParticleBuffers &current);
     void CreateGraphicsPipelines();
     void CreateComputePipelines();
 
-    void CreateCommandPools();
-    void CreateCommandBuffers();
+    Pipeline BuildSimulationPipeline(uint32_t workgroupSize);
+    void TuneSimulationKernel(bool ignoreCache, bool cacheOnly = false);
+    void Retune();
 
-    void CreateSyncObjects();
+    void CreateCommandPools();
 
-    void CreateVertexBuffers();
+    void InitParticleState();
+    void CreateLayoutResources(const ParticleState &state);
+    void CreateParticleBuffers(const ParticleState &state);
+    void SetLayout(ParticleLayout layout);
+
+    [[nodiscard]] VkDeviceSize ParticleStride() const;
+    [[nodiscard]] VkDeviceSize VelocityStride() const;
+    static const char *LayoutSuffix(ParticleLayout layout);
+    [[nodiscard]] std::string ShaderPath(std::string_view name,
+                                         std::string_view stage) const;
+
+    void PackParticles(const ParticleState &state, std::byte *particles,
+                       std::byte *velocities) const;
+    void UnpackParticles(ParticleState &state, const std::byte *particles,
+                         const std::byte *velocities) const;
     void CreateUniformBuffers();
 
     void RecordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex);
     void RecordComputeCommandBuffer(VkCommandBuffer commandBuffer);
+    void RecordDispatch(VkCommandBuffer commandBuffer, size_t frameIndex,
+                        uint32_t emitCount);
+    void RecordSimulation(VkCommandBuffer commandBuffer, const ParticleBuffers &buffers,
+                          VkDescriptorSet descriptorSet, const Pipeline &pipeline,
+                          uint32_t workgroupSize);
+
+    void UpdateEmitters(float deltaTime);
+    void StepCpuSimulation();
+    void EmitCpuParticles();
+    void SetBackend(bool useCpu);
+
+    ParticleState ReadbackParticles(size_t frameIndex);
+    void ValidateBackends();
 
   private:
+    // Shared through ctx.DescriptorLayouts:
     VkDescriptorSetLayout mDescriptorSetLayout;
-    VkDescriptorPool mDescriptorPool;
     std::vector<VkDescriptorSet> mDescriptorSets;
 
     Pipeline mGraphicsPipeline;
     Pipeline mComputePipeline;
+    Pipeline mEmitPipeline;
+
+    WorkgroupTuningResult mTuning;
 
     VkCommandPool mCommandPool;
-    std::vector<VkCommandBuffer> mCommandBuffers;
-    std::vector<VkCommandBuffer> mComputeCommandBuffers;
 
-    struct Vertex {
+    struct Particle {
         glm::vec2 Pos;
         glm::vec2 Velocity;
+    };
 
-        static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
+    // Layout matches the counter buffer in Particle.comp, first four
+    // members are consumed directly by vkCmdDrawIndirect:
+    struct ParticleCounters {
+        uint32_t AliveCount = 0;
+        uint32_t InstanceCount = 1;
+        uint32_t FirstVertex = 0;
+        uint32_t FirstInstance = 0;
+        int32_t FreeCount = 0;
     };
 
-    std::vector<Buffer> mVertexBuffers;
-    size_t mVertexCount;
+    static constexpr size_t MAX_PARTICLES = 8192;
+    static constexpr size_t MAX_EMITTERS = 4;
+
+    ParticleLayout mLayout = ParticleLayout::AoS;
+
+    std::vector<ParticleBuffers> mParticleBuffers;
+    // Scratch copies for the autotuner, so tuning never advances the live simulation:
+    std::array<ParticleBuffers, 2> mTuningBuffers;
+    VkDescriptorSet mTuningDescriptorSet;
+    size_t mParticleCount;
+    uint32_t mAliveCount = 0;
 
     std::vector<Buffer> mUniformBuffers;
+    Buffer mTuningUniformBuffer;
+
+    // Layout matches std140 rules, do not reorder:
+    struct EmitterData {
+        glm::vec2 Position = glm::vec2(0.0f);
+        float Spread = 0.05f;
+        float Speed = 0.01f;
+        float Lifetime = 4.0f;
+        uint32_t SpawnCount = 0;
+        uint32_t SpawnOffset = 0;
+        float Pad = 0.0f;
+    };
 
     struct UniformBufferObject {
         glm::mat4 MVP = glm::mat4(1.0f);
         float PointSize = 50.0f;
         float Speed = 25.0f;
         float DeltaTime = 0.0f;
+        uint32_t ParticleCount = 0;
+        uint32_t EmitCount = 0;
+        uint32_t EmitterCount = 0;
+        uint32_t Seed = 0;
+        float Pad = 0.0f;
+        EmitterData Emitters[MAX_EMITTERS];
     };
     UniformBufferObject mUBOData;
 
-    std::vector<VkSemaphore> mComputeFinishedSemaphores;
-    std::vector<VkFence> mComputeInFlightFences;
+    struct Emitter {
+        bool Enabled = true;
+        glm::vec2 Position = glm::vec2(0.0f);
+        float Spread = 0.05f;
+        float Speed = 0.01f;
+        float Lifetime = 4.0f;
+        // Particles per second:
+        float Rate = 150.0f;
+        float Accumulator = 0.0f;
+    };
+    std::vector<Emitter> mEmitters;
+
+    // CPU reference backend:
+    bool mUseCpuBackend = false;
+
+    ParticleSimulator mCpuSimulator;
+    ParticleState mCpuState;
+    std::vector<uint32_t> mCpuFreeList;
+    std::mt19937 mCpuRng;
+    // Results of the CPU step, allocated from the current frame's upload arena:
+    FrameContext::UploadAllocation mCpuUpload;
+
+    // Byte offsets of the regions in the CPU upload:
+    struct StagingLayout {
+        VkDeviceSize Particles;
+        VkDeviceSize Velocities;
+        VkDeviceSize Life;
+        VkDeviceSize Alive;
+        VkDeviceSize Counters;
+        VkDeviceSize Size;
+    };
+    StagingLayout mStagingLayout;
+    float mCpuStepTime = 0.0f;
+
+    struct ValidationResult {
+        bool Done = false;
+        float MaxError = 0.0f;
+        size_t Mismatches = 0;
+    };
+    ValidationResult mValidation;
+
+    // Everything that depends on the particle layout:
+    DeletionQueue mParticleDeletionQueue;
 };
\ No newline at end of file
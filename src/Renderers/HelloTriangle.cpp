@@ -5,6 +5,8 @@
 #include "Shader.h"
 #include "Utils.h"
 
+#include "Profiler.h"
+
 #include "ImGuiContext.h"
 #include "imgui.h"
 
@@ -30,7 +32,7 @@ HelloTriangleRenderer::HelloTriangleRenderer(VulkanContext &ctx,
 {
     CreateDescriptorSets();
     CreateGraphicsPipelines();
-    CreateSwapchainResources();
+    CreateCommandPools();
     CreateVertexBuffers();
     CreateUniformBuffers();
     UpdateDescriptorSets();
@@ -38,22 +40,26 @@ HelloTriangleRenderer::HelloTriangleRenderer(VulkanContext &ctx,
 
 HelloTriangleRenderer::~HelloTriangleRenderer()
 {
-    mSwapchainDeletionQueue.flush();
-    mMainDeletionQueue.flush();
+    mSwapchainDeletionQueue.flush(ctx);
+    mMainDeletionQueue.flush(ctx);
 }
 
 void HelloTriangleRenderer::OnUpdate([[maybe_unused]] float deltatime)
 {
     // Update Uniform buffer data:
-    auto width = static_cast<float>(ctx.Swapchain.extent.width);
-    auto height = static_cast<float>(ctx.Swapchain.extent.height);
+    auto width = static_cast<float>(ctx.GetRenderExtent().width);
+    auto height = static_cast<float>(ctx.GetRenderExtent().height);
 
     float sx = 1.0f, sy = 1.0f;
 
-    if (height < width)
-        sx = width / height;
-    else
-        sy = height / width;
+    // Extent is zero while minimized:
+    if (width > 0.0f && height > 0.0f)
+    {
+        if (height < width)
+            sx = width / height;
+        else
+            sy = height / width;
+    }
 
     auto proj = glm::ortho(-sx, sx, -sy, sy, -1.0f, 1.0f);
 
@@ -73,70 +79,40 @@ void HelloTriangleRenderer::OnImGui()
 
 void HelloTriangleRenderer::OnRenderImpl()
 {
-    auto &imageAcquiredSemaphore = mImageAcquiredSemaphores[mFrameSemaphoreIndex];
-    auto &renderCompleteSemaphore = mRenderCompletedSemaphores[mFrameSemaphoreIndex];
-    auto &fence = mInFlightFences[mFrameSemaphoreIndex];
-
-    vkWaitForFences(ctx.Device, 1, &fence, VK_TRUE, UINT64_MAX);
+    PROFILE_SCOPE("HelloTriangleRenderer::OnRenderImpl");
 
-    common::AcquireNextImage(ctx, imageAcquiredSemaphore, mFrameImageIndex);
+    BeginFrame();
 
-    if (!ctx.SwapchainOk)
+    if (!AcquireFrameImage())
         return;
 
-    vkResetFences(ctx.Device, 1, &fence);
-
     // DrawFrame
     {
-        auto &buffer = mCommandBuffers[mFrameSemaphoreIndex];
+        auto buffer = CurrentFrame().AllocateCommandBuffer(ctx);
 
-        vkResetCommandBuffer(buffer, 0);
         RecordCommandBuffer(buffer, mFrameImageIndex);
 
         auto buffers = std::array<VkCommandBuffer, 1>{buffer};
 
-        common::SubmitGraphicsQueueDefault(mGraphicsQueue, buffers, fence,
-                                           imageAcquiredSemaphore,
-                                           renderCompleteSemaphore);
+        SubmitFrame(buffers);
     }
 
-    common::PresentFrame(ctx, mPresentQueue, renderCompleteSemaphore, mFrameImageIndex);
-}
-
-void HelloTriangleRenderer::CreateSwapchainResources()
-{
-    CreateCommandPools();
-    CreateCommandBuffers();
+    PresentFrame();
 }
 
 void HelloTriangleRenderer::CreateDescriptorSets()
 {
-    auto numFrames = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
-
     // Descriptor layout
     mDescriptorSetLayout =
         DescriptorSetLayoutBuilder()
             .AddBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
             .Build(ctx);
 
-    // Descriptor pool
-    std::vector<PoolCount> poolCounts{
-        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, numFrames},
-    };
-    uint32_t maxSets = numFrames;
-
-    mDescriptorPool = Descriptor::InitPool(ctx, maxSets, poolCounts);
-
     // Descriptor sets allocation
-    std::vector<VkDescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT,
+    std::vector<VkDescriptorSetLayout> layouts(mFramesInFlight,
                                                mDescriptorSetLayout);
 
-    mDescriptorSets = Descriptor::Allocate(ctx, mDescriptorPool, layouts);
-
-    mMainDeletionQueue.push_back([&]() {
-        vkDestroyDescriptorPool(ctx.Device, mDescriptorPool, nullptr);
-        vkDestroyDescriptorSetLayout(ctx.Device, mDescriptorSetLayout, nullptr);
-    });
+    mDescriptorSets = mDescriptorAllocator.Allocate(ctx, layouts);
 }
 
 void HelloTriangleRenderer::CreateGraphicsPipelines()
@@ -160,45 +136,31 @@ void HelloTriangleRenderer::CreateGraphicsPipelines()
                             .SetSwapchainColorFormat(ctx.Swapchain.image_format)
                             .Build(ctx, mDescriptorSetLayout);
 
-    mMainDeletionQueue.push_back([&]() {
-        vkDestroyPipeline(ctx.Device, mGraphicsPipeline.Handle, nullptr);
-        vkDestroyPipelineLayout(ctx.Device, mGraphicsPipeline.Layout, nullptr);
-    });
+    mMainDeletionQueue.push_back(VK_OBJECT_TYPE_PIPELINE, mGraphicsPipeline.Handle);
+    mMainDeletionQueue.push_back(VK_OBJECT_TYPE_PIPELINE_LAYOUT,
+                                 mGraphicsPipeline.Layout);
 }
 
 void HelloTriangleRenderer::CreateCommandPools()
 {
     VkCommandPoolCreateInfo pool_info = {};
     pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-    pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    // Only used for one-off upload commands, frame commands come from FrameContext:
+    pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
     pool_info.queueFamilyIndex =
         ctx.Device.get_queue_index(vkb::QueueType::graphics).value();
 
     if (vkCreateCommandPool(ctx.Device, &pool_info, nullptr, &mCommandPool) != VK_SUCCESS)
         throw std::runtime_error("Failed to create a command pool!");
 
-    mSwapchainDeletionQueue.push_back(
-        [&]() { vkDestroyCommandPool(ctx.Device, mCommandPool, nullptr); });
-}
-
-void HelloTriangleRenderer::CreateCommandBuffers()
-{
-    mCommandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-
-    VkCommandBufferAllocateInfo allocInfo = {};
-    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.commandPool = mCommandPool;
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandBufferCount = static_cast<uint32_t>(mCommandBuffers.size());
-
-    if (vkAllocateCommandBuffers(ctx.Device, &allocInfo, mCommandBuffers.data()) !=
-        VK_SUCCESS)
-        throw std::runtime_error("Failed to allocate command buffers!");
+    mMainDeletionQueue.push_back(VK_OBJECT_TYPE_COMMAND_POOL, mCommandPool);
 }
 
 void HelloTriangleRenderer::RecordCommandBuffer(VkCommandBuffer commandBuffer,
                                                 uint32_t imageIndex)
 {
+    PROFILE_SCOPE("HelloTriangleRenderer::RecordCommandBuffer");
+
     VkCommandBufferBeginInfo begin_info = {};
     begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 
@@ -238,9 +200,16 @@ void HelloTriangleRenderer::RecordCommandBuffer(VkCommandBuffer commandBuffer,
                                 mGraphicsPipeline.Layout, 0, 1,
                                 &mDescriptorSets[mFrameSemaphoreIndex], 0, nullptr);
 
-        vkCmdDraw(commandBuffer, static_cast<uint32_t>(mVertexCount), 1, 0, 0);
+        {
+            GpuZone zone(mGpuProfiler, commandBuffer, "Scene", true);
 
-        ImGuiContextManager::RecordImguiToCommandBuffer(commandBuffer);
+            vkCmdDraw(commandBuffer, static_cast<uint32_t>(mVertexCount), 1, 0, 0);
+        }
+
+        {
+            GpuZone zone(mGpuProfiler, commandBuffer, "ImGui");
+            ImGuiContextManager::RecordImguiToCommandBuffer(commandBuffer);
+        }
     }
     vkCmdEndRendering(commandBuffer);
 
@@ -271,26 +240,28 @@ void HelloTriangleRenderer::CreateVertexBuffers()
         .Size = mVertexCount * sizeof(Vertex),
         .Usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
         .Properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        .MemoryPool = mMemoryPools.Geometry,
     };
 
     mVertexBuffer = Buffer::CreateGPUBuffer(ctx, info);
 
-    mMainDeletionQueue.push_back([&]() { Buffer::DestroyBuffer(ctx, mVertexBuffer); });
+    mMainDeletionQueue.push_back(VK_OBJECT_TYPE_BUFFER, mVertexBuffer.Handle,
+                                 mVertexBuffer.Allocation);
 }
 
 void HelloTriangleRenderer::CreateUniformBuffers()
 {
     VkDeviceSize bufferSize = sizeof(UniformBufferObject);
 
-    mUniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+    mUniformBuffers.resize(mFramesInFlight);
 
     for (auto &uniformBuffer : mUniformBuffers)
+    {
         uniformBuffer = Buffer::CreateMappedUniformBuffer(ctx, bufferSize);
 
-    mMainDeletionQueue.push_back([&]() {
-        for (auto &uniformBuffer : mUniformBuffers)
-            Buffer::DestroyBuffer(ctx, uniformBuffer);
-    });
+        mMainDeletionQueue.push_back(VK_OBJECT_TYPE_BUFFER, uniformBuffer.Handle,
+                                     uniformBuffer.Allocation);
+    }
 }
 
 void HelloTriangleRenderer::UpdateDescriptorSets()
@@ -17,16 +17,12 @@ class HelloTriangleRenderer : public RendererBase {
     void OnImGui() override;
     void OnRenderImpl() override;
 
-  private:
-    void CreateSwapchainResources() override;
-
   private:
     void CreateDescriptorSets();
     void UpdateDescriptorSets();
     void CreateGraphicsPipelines();
 
     void CreateCommandPools();
-    void CreateCommandBuffers();
 
     void CreateVertexBuffers();
     void CreateUniformBuffers();
@@ -34,14 +30,13 @@ class HelloTriangleRenderer : public RendererBase {
     void RecordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex);
 
   private:
+    // Shared through ctx.DescriptorLayouts:
     VkDescriptorSetLayout mDescriptorSetLayout;
-    VkDescriptorPool mDescriptorPool;
     std::vector<VkDescriptorSet> mDescriptorSets;
 
     Pipeline mGraphicsPipeline;
 
     VkCommandPool mCommandPool;
-    std::vector<VkCommandBuffer> mCommandBuffers;
 
     struct Vertex {
         glm::vec2 Pos;
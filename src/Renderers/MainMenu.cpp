@@ -2,6 +2,8 @@
 
 #include "Common.h"
 
+#include "Profiler.h"
+
 #include "ImGuiContext.h"
 #include "imgui.h"
 
@@ -11,13 +13,12 @@
 MainMenuRenderer::MainMenuRenderer(VulkanContext &ctx, std::function<void()> callback)
     : RendererBase(ctx, callback)
 {
-    CreateSwapchainResources();
 }
 
 MainMenuRenderer::~MainMenuRenderer()
 {
-    mSwapchainDeletionQueue.flush();
-    mMainDeletionQueue.flush();
+    mSwapchainDeletionQueue.flush(ctx);
+    mMainDeletionQueue.flush(ctx);
 }
 
 void MainMenuRenderer::OnImGui()
@@ -29,75 +30,32 @@ void MainMenuRenderer::OnImGui()
 
 void MainMenuRenderer::OnRenderImpl()
 {
-    auto &imageAcquiredSemaphore = mImageAcquiredSemaphores[mFrameSemaphoreIndex];
-    auto &renderCompleteSemaphore = mRenderCompletedSemaphores[mFrameSemaphoreIndex];
-    auto &fence = mInFlightFences[mFrameSemaphoreIndex];
-
-    vkWaitForFences(ctx.Device, 1, &fence, VK_TRUE, UINT64_MAX);
+    PROFILE_SCOPE("MainMenuRenderer::OnRenderImpl");
 
-    common::AcquireNextImage(ctx, imageAcquiredSemaphore, mFrameImageIndex);
+    BeginFrame();
 
-    if (!ctx.SwapchainOk)
+    if (!AcquireFrameImage())
         return;
 
-    vkResetFences(ctx.Device, 1, &fence);
-
     // DrawFrame
     {
-        auto &buffer = mCommandBuffers[mFrameSemaphoreIndex];
+        auto buffer = CurrentFrame().AllocateCommandBuffer(ctx);
 
-        vkResetCommandBuffer(buffer, 0);
         RecordCommandBuffer(buffer, mFrameImageIndex);
 
-        std::array<VkCommandBuffer, 1> buffers{{buffer}};
+        auto buffers = std::array<VkCommandBuffer, 1>{buffer};
 
-        common::SubmitGraphicsQueueDefault(mGraphicsQueue, buffers, fence,
-                                           imageAcquiredSemaphore,
-                                           renderCompleteSemaphore);
+        SubmitFrame(buffers);
     }
 
-    common::PresentFrame(ctx, mPresentQueue, renderCompleteSemaphore, mFrameImageIndex);
-}
-
-void MainMenuRenderer::CreateSwapchainResources()
-{
-    CreateCommandPools();
-    CreateCommandBuffers();
-}
-
-void MainMenuRenderer::CreateCommandPools()
-{
-    VkCommandPoolCreateInfo pool_info = {};
-    pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-    pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-    pool_info.queueFamilyIndex =
-        ctx.Device.get_queue_index(vkb::QueueType::graphics).value();
-
-    if (vkCreateCommandPool(ctx.Device, &pool_info, nullptr, &mCommandPool) != VK_SUCCESS)
-        throw std::runtime_error("Failed to create a command pool!");
-
-    mSwapchainDeletionQueue.push_back(
-        [&]() { vkDestroyCommandPool(ctx.Device, mCommandPool, nullptr); });
-}
-
-void MainMenuRenderer::CreateCommandBuffers()
-{
-    mCommandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-
-    VkCommandBufferAllocateInfo allocInfo = {};
-    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.commandPool = mCommandPool;
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandBufferCount = static_cast<uint32_t>(mCommandBuffers.size());
-
-    if (vkAllocateCommandBuffers(ctx.Device, &allocInfo, mCommandBuffers.data()) !=
-        VK_SUCCESS)
-        throw std::runtime_error("Failed to allocate command buffers!");
+    PresentFrame();
 }
 
 void MainMenuRenderer::RecordCommandBuffer(VkCommandBuffer commandBuffer,
                                            uint32_t imageIndex)
 {
+    PROFILE_SCOPE("MainMenuRenderer::RecordCommandBuffer");
+
     VkCommandBufferBeginInfo begin_info = {};
     begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 
@@ -126,7 +84,10 @@ void MainMenuRenderer::RecordCommandBuffer(VkCommandBuffer commandBuffer,
     {
         common::ViewportScissorDefaultBehaviour(ctx, commandBuffer);
 
-        ImGuiContextManager::RecordImguiToCommandBuffer(commandBuffer);
+        {
+            GpuZone zone(mGpuProfiler, commandBuffer, "ImGui");
+            ImGuiContextManager::RecordImguiToCommandBuffer(commandBuffer);
+        }
     }
     vkCmdEndRendering(commandBuffer);
 
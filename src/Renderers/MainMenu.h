@@ -14,15 +14,5 @@ class MainMenuRenderer : public RendererBase {
     void OnRenderImpl() override;
 
   private:
-    void CreateSwapchainResources() override;
-
-  private:
-    void CreateCommandPools();
-    void CreateCommandBuffers();
-
     void RecordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex);
-
-  private:
-    VkCommandPool mCommandPool;
-    std::vector<VkCommandBuffer> mCommandBuffers;
 };
\ No newline at end of file
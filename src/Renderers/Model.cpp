@@ -9,14 +9,20 @@
 #include "Sampler.h"
 #include "Shader.h"
 
+#include "Profiler.h"
+
 #include "ImGuiContext.h"
 #include "imgui.h"
 
 #include <cstdint>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <algorithm>
 #include <array>
+#include <chrono>
+#include <cstdio>
 #include <filesystem>
+#include <fstream>
 #include <stdexcept>
 #include <vulkan/vulkan_core.h>
 
@@ -38,10 +44,14 @@ std::vector<VkVertexInputAttributeDescription> ModelRenderer::Vertex::
 }
 
 ModelRenderer::ModelRenderer(VulkanContext &ctx, std::function<void()> callback)
-    : RendererBase(ctx, callback)
+    : RendererBase(ctx, callback), mRecorder(*ctx.Jobs)
 {
+    mDepthFormat = utils::FindDepthFormat(ctx);
+    mRecordThreads = static_cast<int>(mRecorder.NumThreads());
+
     CreateDescriptorSets();
     CreateGraphicsPipelines();
+    CreateCommandPools();
     CreateSwapchainResources();
     LoadModel();
     CreateTextureResources();
@@ -51,17 +61,18 @@ ModelRenderer::ModelRenderer(VulkanContext &ctx, std::function<void()> callback)
 
 ModelRenderer::~ModelRenderer()
 {
-    mSwapchainDeletionQueue.flush();
-    mMainDeletionQueue.flush();
+    mSwapchainDeletionQueue.flush(ctx);
+    mMainDeletionQueue.flush(ctx);
 }
 
 void ModelRenderer::OnUpdate([[maybe_unused]] float deltatime)
 {
     // Update Uniform buffer data:
-    auto width = static_cast<float>(ctx.Swapchain.extent.width);
-    auto height = static_cast<float>(ctx.Swapchain.extent.height);
+    auto width = static_cast<float>(ctx.GetRenderExtent().width);
+    auto height = static_cast<float>(ctx.GetRenderExtent().height);
 
-    float aspect = width / height;
+    // Extent is zero while minimized:
+    float aspect = height > 0.0f ? width / height : 1.0f;
 
     glm::vec3 pos{0.0f, 0.0f, -mCameraDistance};
     glm::vec3 front{0.0f, 0.0f, 1.0f};
@@ -86,52 +97,48 @@ void ModelRenderer::OnImGui()
     callback();
     ImGui::SliderFloat("Rotation", &mRotationAngle, 0.0f, 6.28f);
     ImGui::SliderFloat("Camera distance", &mCameraDistance, 0.0f, 10.0f);
+
+    if (ImGui::Button("Reload shaders"))
+        ReloadPipelines();
+
+    if (!mReloadError.empty())
+        ImGui::Text("Reload failed: %s", mReloadError.c_str());
+
+    RecordBenchmarkImGui();
     ImGui::End();
 }
 
 void ModelRenderer::OnRenderImpl()
 {
-    auto &imageAcquiredSemaphore = mImageAcquiredSemaphores[mFrameSemaphoreIndex];
-    auto &renderCompleteSemaphore = mRenderCompletedSemaphores[mFrameSemaphoreIndex];
-    auto &fence = mInFlightFences[mFrameSemaphoreIndex];
-
-    vkWaitForFences(ctx.Device, 1, &fence, VK_TRUE, UINT64_MAX);
+    PROFILE_SCOPE("ModelRenderer::OnRenderImpl");
 
-    common::AcquireNextImage(ctx, imageAcquiredSemaphore, mFrameImageIndex);
+    BeginFrame();
+    mRecorder.BeginFrame(ctx, mFrameSemaphoreIndex);
 
-    if (!ctx.SwapchainOk)
+    if (!AcquireFrameImage())
         return;
 
-    vkResetFences(ctx.Device, 1, &fence);
-
     // DrawFrame
     {
-        auto &buffer = mCommandBuffers[mFrameSemaphoreIndex];
+        auto buffer = CurrentFrame().AllocateCommandBuffer(ctx);
 
-        vkResetCommandBuffer(buffer, 0);
         RecordCommandBuffer(buffer, mFrameImageIndex);
 
         auto buffers = std::array<VkCommandBuffer, 1>{buffer};
 
-        common::SubmitGraphicsQueueDefault(mGraphicsQueue, buffers, fence,
-                                           imageAcquiredSemaphore,
-                                           renderCompleteSemaphore);
+        SubmitFrame(buffers);
     }
 
-    common::PresentFrame(ctx, mPresentQueue, renderCompleteSemaphore, mFrameImageIndex);
+    PresentFrame();
 }
 
 void ModelRenderer::CreateSwapchainResources()
 {
     CreateDepthResources();
-    CreateCommandPools();
-    CreateCommandBuffers();
 }
 
 void ModelRenderer::CreateDescriptorSets()
 {
-    auto numFrames = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
-
     // Descriptor layout
     mDescriptorSetLayout =
         DescriptorSetLayoutBuilder()
@@ -140,90 +147,106 @@ void ModelRenderer::CreateDescriptorSets()
                         VK_SHADER_STAGE_FRAGMENT_BIT)
             .Build(ctx);
 
-    // Descriptor pool
-    std::vector<PoolCount> poolCounts{
-        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, numFrames},
-        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, numFrames},
-    };
-    uint32_t maxSets = numFrames;
-
-    mDescriptorPool = Descriptor::InitPool(ctx, maxSets, poolCounts);
-
     // Descriptor sets allocation
-    std::vector<VkDescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT,
+    std::vector<VkDescriptorSetLayout> layouts(mFramesInFlight,
                                                mDescriptorSetLayout);
 
-    mDescriptorSets = Descriptor::Allocate(ctx, mDescriptorPool, layouts);
+    mDescriptorSets = mDescriptorAllocator.Allocate(ctx, layouts);
+}
 
+void ModelRenderer::CreateGraphicsPipelines()
+{
+    mGraphicsPipeline = BuildGraphicsPipeline();
+
+    // Destroys whichever pipeline is current at the time:
     mMainDeletionQueue.push_back([&]() {
-        vkDestroyDescriptorPool(ctx.Device, mDescriptorPool, nullptr);
-        vkDestroyDescriptorSetLayout(ctx.Device, mDescriptorSetLayout, nullptr);
+        vkDestroyPipeline(ctx.Device, mGraphicsPipeline.Handle, nullptr);
+        vkDestroyPipelineLayout(ctx.Device, mGraphicsPipeline.Layout, nullptr);
     });
 }
 
-void ModelRenderer::CreateGraphicsPipelines()
+Pipeline ModelRenderer::BuildGraphicsPipeline()
 {
-    auto shaderStages = ShaderBuilder()
-                            .SetVertexPath("assets/spirv/TexturedCubeVert.spv")
-                            .SetFragmentPath("assets/spirv/TexturedCubeFrag.spv")
-                            .Build(ctx);
+    bool pulling = ctx.Config.VertexPulling;
+
+    // Same vertex layout as the cube, so its shaders are reused:
+    auto shaderStages =
+        ShaderBuilder()
+            .SetVertexPath(pulling ? "assets/spirv/TexturedCubePulledVert.spv"
+                                   : "assets/spirv/TexturedCubeVert.spv")
+            .SetFragmentPath("assets/spirv/TexturedCubeFrag.spv")
+            .Build(ctx);
 
     auto bindingDescription =
         utils::GetBindingDescription<Vertex>(0, VK_VERTEX_INPUT_RATE_VERTEX);
     auto attributeDescriptions = Vertex::getAttributeDescriptions();
 
-    VkFormat depthFormat = utils::FindDepthFormat(ctx);
+    auto builder = PipelineBuilder()
+                       .SetShaderStages(shaderStages)
+                       .SetTopology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST)
+                       .SetPolygonMode(VK_POLYGON_MODE_FILL)
+                       .SetCullMode(VK_CULL_MODE_BACK_BIT, VK_FRONT_FACE_CLOCKWISE)
+                       .EnableDepthTest()
+                       .SetSwapchainColorFormat(ctx.Swapchain.image_format)
+                       .SetDepthFormat(mDepthFormat);
+
+    if (pulling)
+        builder.SetPushConstants(VK_SHADER_STAGE_VERTEX_BIT,
+                                 sizeof(GeometryArena::PullConstants));
+    else
+        builder.SetVertexInput(bindingDescription, attributeDescriptions);
+
+    return builder.Build(ctx, mDescriptorSetLayout);
+}
 
-    mGraphicsPipeline = PipelineBuilder()
-                            .SetShaderStages(shaderStages)
-                            .SetVertexInput(bindingDescription, attributeDescriptions)
-                            .SetTopology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST)
-                            .SetPolygonMode(VK_POLYGON_MODE_FILL)
-                            .SetCullMode(VK_CULL_MODE_BACK_BIT, VK_FRONT_FACE_CLOCKWISE)
-                            .EnableDepthTest()
-                            .SetSwapchainColorFormat(ctx.Swapchain.image_format)
-                            .SetDepthFormat(depthFormat)
-                            .Build(ctx, mDescriptorSetLayout);
+void ModelRenderer::ReloadPipelines()
+{
+    // Build first, so a broken shader leaves the current pipeline in place:
+    Pipeline pipeline;
 
-    mMainDeletionQueue.push_back([&]() {
-        vkDestroyPipeline(ctx.Device, mGraphicsPipeline.Handle, nullptr);
-        vkDestroyPipelineLayout(ctx.Device, mGraphicsPipeline.Layout, nullptr);
-    });
+    try
+    {
+        pipeline = BuildGraphicsPipeline();
+        mReloadError.clear();
+    }
+    catch (const std::exception &e)
+    {
+        mReloadError = e.what();
+        return;
+    }
+
+    // Frames in flight keep using the old pipeline until they finish:
+    DeferDeletion(VK_OBJECT_TYPE_PIPELINE, mGraphicsPipeline.Handle);
+    DeferDeletion(VK_OBJECT_TYPE_PIPELINE_LAYOUT, mGraphicsPipeline.Layout);
+
+    mGraphicsPipeline = pipeline;
 }
 
 void ModelRenderer::CreateCommandPools()
 {
     VkCommandPoolCreateInfo pool_info = {};
     pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-    pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    // Only used for one-off upload commands, frame commands come from FrameContext:
+    pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
     pool_info.queueFamilyIndex =
         ctx.Device.get_queue_index(vkb::QueueType::graphics).value();
 
     if (vkCreateCommandPool(ctx.Device, &pool_info, nullptr, &mCommandPool) != VK_SUCCESS)
         throw std::runtime_error("Failed to create a command pool!");
 
-    mSwapchainDeletionQueue.push_back(
-        [&]() { vkDestroyCommandPool(ctx.Device, mCommandPool, nullptr); });
-}
-
-void ModelRenderer::CreateCommandBuffers()
-{
-    mCommandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+    mMainDeletionQueue.push_back(VK_OBJECT_TYPE_COMMAND_POOL, mCommandPool);
 
-    VkCommandBufferAllocateInfo allocInfo = {};
-    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.commandPool = mCommandPool;
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandBufferCount = static_cast<uint32_t>(mCommandBuffers.size());
+    // Per-thread pools for secondary buffers:
+    mRecorder.Init(ctx, mFramesInFlight);
 
-    if (vkAllocateCommandBuffers(ctx.Device, &allocInfo, mCommandBuffers.data()) !=
-        VK_SUCCESS)
-        throw std::runtime_error("Failed to allocate command buffers!");
+    mMainDeletionQueue.push_back([&]() { mRecorder.Destroy(ctx); });
 }
 
 void ModelRenderer::RecordCommandBuffer(VkCommandBuffer commandBuffer,
                                         uint32_t imageIndex)
 {
+    PROFILE_SCOPE("ModelRenderer::RecordCommandBuffer");
+
     VkCommandBufferBeginInfo begin_info = {};
     begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 
@@ -251,6 +274,7 @@ void ModelRenderer::RecordCommandBuffer(VkCommandBuffer commandBuffer,
 
     VkRenderingInfoKHR renderingInfo{};
     renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+    renderingInfo.flags = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT;
     renderingInfo.renderArea = {
         {0, 0}, {ctx.Swapchain.extent.width, ctx.Swapchain.extent.height}};
     renderingInfo.layerCount = 1;
@@ -259,29 +283,60 @@ void ModelRenderer::RecordCommandBuffer(VkCommandBuffer commandBuffer,
     renderingInfo.pDepthAttachment = &depthAttachment;
     // renderingInfo.pStencilAttachment = &stencilAttachment;
 
-    vkCmdBeginRendering(commandBuffer, &renderingInfo);
-    {
-        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                          mGraphicsPipeline.Handle);
+    // Secondary buffers need to know the attachment formats of the pass:
+    VkCommandBufferInheritanceRenderingInfo inheritanceInfo{};
+    inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO;
+    inheritanceInfo.colorAttachmentCount = 1;
+    inheritanceInfo.pColorAttachmentFormats = &ctx.Swapchain.image_format;
+    inheritanceInfo.depthAttachmentFormat = mDepthFormat;
+    inheritanceInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
 
-        common::ViewportScissorDefaultBehaviour(ctx, commandBuffer);
+    // Recorder always records at least one chunk (empty if there is nothing to draw),
+    // clamped here so the chunk ranges agree with it:
+    size_t numDraws = mSurfaces.size() * static_cast<size_t>(mDrawRepeats);
+    size_t numChunks = std::min(static_cast<size_t>(mRecordThreads), numDraws);
+    numChunks = std::clamp<size_t>(numChunks, 1, mRecorder.NumThreads());
 
-        std::array<VkBuffer, 1> vertexBuffers{mVertexBuffer.Handle};
-        std::array<VkDeviceSize, 1> offsets{0};
-        vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers.data(), offsets.data());
+    auto recordStart = std::chrono::steady_clock::now();
 
-        vkCmdBindIndexBuffer(commandBuffer, mIndexBuffer.Handle, 0, VK_INDEX_TYPE_UINT32);
+    auto secondaryBuffers =
+        mRecorder.Record(ctx, inheritanceInfo, numChunks,
+                         [&](VkCommandBuffer secondary, size_t chunk) {
+                             RecordSceneChunk(secondary, chunk, numChunks);
+                         });
 
-        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                                mGraphicsPipeline.Layout, 0, 1,
-                                &mDescriptorSets[mFrameSemaphoreIndex], 0, nullptr);
+    std::chrono::duration<double, std::milli> recordTime =
+        std::chrono::steady_clock::now() - recordStart;
 
-        for (auto &surf : mSurfaces)
-            vkCmdDrawIndexed(commandBuffer, surf.Count, 1, surf.StartIndex, 0, 0);
+    mRecordMilliseconds = recordTime.count();
+    UpdateRecordBenchmark(mRecordMilliseconds);
 
-        ImGuiContextManager::RecordImguiToCommandBuffer(commandBuffer);
+    {
+        // Timings only, statistics queries can't stay active while executing
+        // secondary buffers without the inheritedQueries feature:
+        GpuZone zone(mGpuProfiler, commandBuffer, "Scene");
+
+        vkCmdBeginRendering(commandBuffer, &renderingInfo);
+
+        // Executed in chunk order, so the result matches single threaded recording:
+        vkCmdExecuteCommands(commandBuffer,
+                             static_cast<uint32_t>(secondaryBuffers.size()),
+                             secondaryBuffers.data());
+
+        vkCmdEndRendering(commandBuffer);
     }
 
+    // ImGui is recorded inline, in a second pass on top of the scene:
+    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+    depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    renderingInfo.flags = 0;
+
+    vkCmdBeginRendering(commandBuffer, &renderingInfo);
+    {
+        GpuZone zone(mGpuProfiler, commandBuffer, "ImGui");
+        ImGuiContextManager::RecordImguiToCommandBuffer(commandBuffer);
+    }
     vkCmdEndRendering(commandBuffer);
 
     common::ImageBarrierColorToPresent(commandBuffer, ctx.SwapchainImages[imageIndex]);
@@ -290,8 +345,176 @@ void ModelRenderer::RecordCommandBuffer(VkCommandBuffer commandBuffer,
         throw std::runtime_error("Failed to record command buffer!");
 }
 
+void ModelRenderer::RecordSceneChunk(VkCommandBuffer commandBuffer, size_t chunk,
+                                     size_t numChunks)
+{
+    // State is not inherited, so every secondary buffer binds it again:
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                      mGraphicsPipeline.Handle);
+
+    common::ViewportScissorDefaultBehaviour(ctx, commandBuffer);
+
+    ctx.Geometry->Bind(commandBuffer);
+
+    if (ctx.Config.VertexPulling)
+        ctx.Geometry->PushPullConstants(commandBuffer, mGraphicsPipeline.Layout,
+                                        sizeof(Vertex));
+
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                            mGraphicsPipeline.Layout, 0, 1,
+                            &mDescriptorSets[mFrameSemaphoreIndex], 0, nullptr);
+
+    // Contiguous ranges of the draw list, so chunks stay in draw order:
+    size_t numDraws = mSurfaces.size() * static_cast<size_t>(mDrawRepeats);
+
+    if (numDraws == 0)
+        return;
+
+    size_t begin = chunk * numDraws / numChunks;
+    size_t end = (chunk + 1) * numDraws / numChunks;
+
+    const size_t numSurfaces = mSurfaces.size();
+
+    for (size_t i = begin; i < end;)
+    {
+        // Up to the end of the chunk or of the current copy of the surface list:
+        size_t first = i % numSurfaces;
+        size_t count = std::min(end - i, numSurfaces - first);
+
+        DrawSurfaces(commandBuffer, first, count);
+        i += count;
+    }
+}
+
+void ModelRenderer::DrawSurfaces(VkCommandBuffer commandBuffer, size_t first,
+                                 size_t count)
+{
+    constexpr auto stride = static_cast<uint32_t>(sizeof(VkDrawIndexedIndirectCommand));
+
+    VkDeviceSize offset = first * stride;
+
+    if (ctx.MultiDrawIndirectSupported)
+    {
+        vkCmdDrawIndexedIndirect(commandBuffer, mIndirectBuffer.Handle, offset,
+                                 static_cast<uint32_t>(count), stride);
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        vkCmdDrawIndexedIndirect(commandBuffer, mIndirectBuffer.Handle, offset, 1,
+                                 stride);
+        offset += stride;
+    }
+}
+
+void ModelRenderer::UpdateRecordBenchmark(double recordMilliseconds)
+{
+    auto &bench = mBenchmark;
+
+    if (!bench.Running)
+        return;
+
+    // First frames after changing the thread count are skipped as a warm up:
+    if (bench.Frame >= BENCHMARK_WARMUP_FRAMES)
+        bench.Accumulated += recordMilliseconds;
+
+    bench.Frame++;
+
+    if (bench.Frame < BENCHMARK_WARMUP_FRAMES + BENCHMARK_MEASURED_FRAMES)
+        return;
+
+    bench.Milliseconds.push_back(bench.Accumulated / BENCHMARK_MEASURED_FRAMES);
+
+    bench.Threads++;
+    bench.Frame = 0;
+    bench.Accumulated = 0.0;
+
+    if (bench.Threads > mRecorder.NumThreads())
+    {
+        bench.Running = false;
+        mRecordThreads = bench.PreviousThreads;
+    }
+    else
+    {
+        mRecordThreads = static_cast<int>(bench.Threads);
+    }
+}
+
+void ModelRenderer::RecordBenchmarkImGui()
+{
+    ImGui::Separator();
+
+    ImGui::BeginDisabled(mBenchmark.Running);
+    ImGui::SliderInt("Record threads", &mRecordThreads, 1,
+                     static_cast<int>(mRecorder.NumThreads()));
+    ImGui::SliderInt("Draw list copies", &mDrawRepeats, 1, 4096);
+    ImGui::EndDisabled();
+
+    ImGui::Text("Record time: %.3f ms", mRecordMilliseconds);
+
+    if (mBenchmark.Running)
+    {
+        ImGui::Text("Measuring %zu/%zu threads...", mBenchmark.Threads,
+                    mRecorder.NumThreads());
+    }
+    else if (ImGui::Button("Measure record scaling"))
+    {
+        mBenchmark = RecordBenchmark{
+            .Running = true,
+            .Threads = 1,
+            .PreviousThreads = mRecordThreads,
+        };
+
+        mRecordThreads = 1;
+    }
+
+    if (mBenchmark.Milliseconds.empty())
+        return;
+
+    double baseline = mBenchmark.Milliseconds[0];
+
+    for (size_t i = 0; i < mBenchmark.Milliseconds.size(); i++)
+    {
+        double ms = mBenchmark.Milliseconds[i];
+        ImGui::Text("%zu threads: %.3f ms (x%.2f)", i + 1, ms, baseline / ms);
+    }
+
+    if (!mBenchmark.Running && ImGui::Button("Save report"))
+    {
+        std::ofstream file("record_scaling.txt");
+        file << RecordBenchmarkReport();
+    }
+}
+
+std::string ModelRenderer::RecordBenchmarkReport() const
+{
+    std::array<char, 256> line{};
+
+    std::snprintf(line.data(), line.size(),
+                  "Command recording: %zu draws, %zu hardware threads\n",
+                  mSurfaces.size() * static_cast<size_t>(mDrawRepeats),
+                  mRecorder.NumThreads());
+    std::string report = line.data();
+
+    double baseline = mBenchmark.Milliseconds.empty() ? 0.0 : mBenchmark.Milliseconds[0];
+
+    for (size_t i = 0; i < mBenchmark.Milliseconds.size(); i++)
+    {
+        double ms = mBenchmark.Milliseconds[i];
+
+        std::snprintf(line.data(), line.size(), "%2zu threads %8.4f ms  speedup x%.2f\n",
+                      i + 1, ms, baseline / ms);
+        report += line.data();
+    }
+
+    return report;
+}
+
 void ModelRenderer::LoadModel()
 {
+    PROFILE_SCOPE("ModelRenderer::LoadModel");
+
     // Retrieve data from gltf file:
     std::vector<uint32_t> indices;
     std::vector<Vertex> vertices;
@@ -383,59 +606,55 @@ void ModelRenderer::LoadModel()
         }
     }
 
-    // Upload data to GPU buffers:
+    // Upload data to the geometry arena:
+    mMesh = ctx.Geometry->Upload(mGraphicsQueue, mCommandPool, vertices, indices);
 
-    // Vertex buffer:
-    {
-        mVertexCount = vertices.size();
-
-        GPUBufferInfo info{
-            .Queue = mGraphicsQueue,
-            .Pool = mCommandPool,
-            .Data = vertices.data(),
-            .Size = mVertexCount * sizeof(Vertex),
-            .Usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-            .Properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-        };
+    mMainDeletionQueue.push_back([&]() { ctx.Geometry->Free(mMesh); });
 
-        mVertexBuffer = Buffer::CreateGPUBuffer(ctx, info);
+    // Indirect commands, with surfaces offset into the arena:
+    std::vector<VkDrawIndexedIndirectCommand> commands;
+    commands.reserve(mSurfaces.size());
 
-        mMainDeletionQueue.push_back(
-            [&]() { Buffer::DestroyBuffer(ctx, mVertexBuffer); });
+    for (auto &surf : mSurfaces)
+    {
+        commands.push_back(VkDrawIndexedIndirectCommand{
+            .indexCount = surf.Count,
+            .instanceCount = 1,
+            .firstIndex = mMesh.FirstIndex + surf.StartIndex,
+            .vertexOffset = mMesh.VertexOffset,
+            .firstInstance = 0,
+        });
     }
 
-    // Index buffer:
-    {
-        mIndexCount = indices.size();
-
-        GPUBufferInfo info{
-            .Queue = mGraphicsQueue,
-            .Pool = mCommandPool,
-            .Data = indices.data(),
-            .Size = mIndexCount * sizeof(uint32_t),
-            .Usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-            .Properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-        };
+    GPUBufferInfo info{
+        .Queue = mGraphicsQueue,
+        .Pool = mCommandPool,
+        .Data = commands.data(),
+        .Size = commands.size() * sizeof(VkDrawIndexedIndirectCommand),
+        .Usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+        .Properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        .MemoryPool = mMemoryPools.Geometry,
+    };
 
-        mIndexBuffer = Buffer::CreateGPUBuffer(ctx, info);
+    mIndirectBuffer = Buffer::CreateGPUBuffer(ctx, info);
 
-        mMainDeletionQueue.push_back([&]() { Buffer::DestroyBuffer(ctx, mIndexBuffer); });
-    }
+    mMainDeletionQueue.push_back(VK_OBJECT_TYPE_BUFFER, mIndirectBuffer.Handle,
+                                 mIndirectBuffer.Allocation);
 }
 
 void ModelRenderer::CreateUniformBuffers()
 {
     VkDeviceSize bufferSize = sizeof(UniformBufferObject);
 
-    mUniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+    mUniformBuffers.resize(mFramesInFlight);
 
     for (auto &uniformBuffer : mUniformBuffers)
+    {
         uniformBuffer = Buffer::CreateMappedUniformBuffer(ctx, bufferSize);
 
-    mMainDeletionQueue.push_back([&]() {
-        for (auto &uniformBuffer : mUniformBuffers)
-            Buffer::DestroyBuffer(ctx, uniformBuffer);
-    });
+        mMainDeletionQueue.push_back(VK_OBJECT_TYPE_BUFFER, uniformBuffer.Handle,
+                                     uniformBuffer.Allocation);
+    }
 }
 
 void ModelRenderer::UpdateDescriptorSets()
@@ -481,6 +700,7 @@ void ModelRenderer::CreateTextureResources()
         .Queue = mGraphicsQueue,
         .Pool = mCommandPool,
         .Filepath = "assets/gltf/DamagedHelmet/Default_albedo.jpg",
+        .MemoryPool = mMemoryPools.Textures,
     };
 
     mTextureImage = ImageLoaders::LoadImage2D(ctx, info);
@@ -494,21 +714,18 @@ void ModelRenderer::CreateTextureResources()
                           .SetAddressMode(VK_SAMPLER_ADDRESS_MODE_REPEAT)
                           .Build(ctx);
 
-    mMainDeletionQueue.push_back([&]() {
-        vkDestroySampler(ctx.Device, mTextureSampler, nullptr);
-        vkDestroyImageView(ctx.Device, mTextureImageView, nullptr);
-        Image::DestroyImage(ctx, mTextureImage);
-    });
+    mMainDeletionQueue.push_back(VK_OBJECT_TYPE_IMAGE, mTextureImage.Handle,
+                                 mTextureImage.Allocation);
+    mMainDeletionQueue.push_back(VK_OBJECT_TYPE_IMAGE_VIEW, mTextureImageView);
+    mMainDeletionQueue.push_back(VK_OBJECT_TYPE_SAMPLER, mTextureSampler);
 }
 
 void ModelRenderer::CreateDepthResources()
 {
-    VkFormat depthFormat = utils::FindDepthFormat(ctx);
-
     ImageInfo info{
         .Width = ctx.Swapchain.extent.width,
         .Height = ctx.Swapchain.extent.height,
-        .Format = depthFormat,
+        .Format = mDepthFormat,
         .Tiling = VK_IMAGE_TILING_OPTIMAL,
         .Usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
         .Properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
@@ -516,11 +733,12 @@ void ModelRenderer::CreateDepthResources()
 
     mDepthImage = Image::CreateImage(ctx, info);
 
-    mDepthImageView = ImageView::Create(ctx, mDepthImage.Handle, depthFormat,
+    mDepthImageView = ImageView::Create(ctx, mDepthImage.Handle, mDepthFormat,
                                         VK_IMAGE_ASPECT_DEPTH_BIT);
 
-    mSwapchainDeletionQueue.push_back([&]() {
-        vkDestroyImageView(ctx.Device, mDepthImageView, nullptr);
-        Image::DestroyImage(ctx, mDepthImage);
-    });
+    // Stored by value, since recreation may retire these while new
+    // ones are already in use:
+    mSwapchainDeletionQueue.push_back(VK_OBJECT_TYPE_IMAGE, mDepthImage.Handle,
+                                      mDepthImage.Allocation);
+    mSwapchainDeletionQueue.push_back(VK_OBJECT_TYPE_IMAGE_VIEW, mDepthImageView);
 }
\ No newline at end of file
@@ -3,11 +3,17 @@
 #include "RendererBase.h"
 
 #include "Buffer.h"
+#include "GeometryArena.h"
 #include "Image.h"
+#include "ParallelRecorder.h"
 #include "Pipeline.h"
 
 #include <glm/glm.hpp>
 
+#include <cstddef>
+#include <string>
+#include <vector>
+
 class ModelRenderer : public RendererBase {
   public:
     ModelRenderer(VulkanContext &ctx, std::function<void()> callback);
@@ -25,9 +31,11 @@ class ModelRenderer : public RendererBase {
     void CreateDescriptorSets();
     void UpdateDescriptorSets();
     void CreateGraphicsPipelines();
+    Pipeline BuildGraphicsPipeline();
+    // Rebuilds pipelines from the current shader binaries, without stalling:
+    void ReloadPipelines();
 
     void CreateCommandPools();
-    void CreateCommandBuffers();
 
     void LoadModel();
     void CreateUniformBuffers();
@@ -36,16 +44,23 @@ class ModelRenderer : public RendererBase {
     void CreateDepthResources();
 
     void RecordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+    void RecordSceneChunk(VkCommandBuffer commandBuffer, size_t chunk,
+                          size_t numChunks);
+    void DrawSurfaces(VkCommandBuffer commandBuffer, size_t first, size_t count);
+
+    void UpdateRecordBenchmark(double recordMilliseconds);
+    void RecordBenchmarkImGui();
+    [[nodiscard]] std::string RecordBenchmarkReport() const;
 
   private:
+    // Shared through ctx.DescriptorLayouts:
     VkDescriptorSetLayout mDescriptorSetLayout;
-    VkDescriptorPool mDescriptorPool;
     std::vector<VkDescriptorSet> mDescriptorSets;
 
     Pipeline mGraphicsPipeline;
+    std::string mReloadError;
 
     VkCommandPool mCommandPool;
-    std::vector<VkCommandBuffer> mCommandBuffers;
 
     struct Vertex {
         glm::vec3 Pos;
@@ -54,19 +69,44 @@ class ModelRenderer : public RendererBase {
         static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
     };
 
-    Buffer mVertexBuffer;
-    size_t mVertexCount;
-
-    Buffer mIndexBuffer;
-    size_t mIndexCount;
+    // All surfaces share one mesh, suballocated from ctx.Geometry:
+    GeometryArena::Mesh mMesh;
 
     struct GeoSurface {
+        // Relative to the first index of the mesh:
         uint32_t StartIndex;
         uint32_t Count;
     };
 
     std::vector<GeoSurface> mSurfaces;
 
+    // One VkDrawIndexedIndirectCommand per surface, runs of consecutive
+    // surfaces are drawn with a single call:
+    Buffer mIndirectBuffer;
+
+    // Scene draws are split into chunks recorded on separate threads.
+    // The draw list is the surface list repeated mDrawRepeats times,
+    // to stress recording with a scene this small:
+    ParallelRecorder mRecorder;
+    int mRecordThreads = 1;
+    int mDrawRepeats = 1;
+    double mRecordMilliseconds = 0.0;
+
+    // Average record time for every thread count, measured over
+    // consecutive frames:
+    struct RecordBenchmark {
+        bool Running = false;
+        size_t Threads = 0;
+        size_t Frame = 0;
+        double Accumulated = 0.0;
+        int PreviousThreads = 1;
+        std::vector<double> Milliseconds;
+    };
+    RecordBenchmark mBenchmark;
+
+    static constexpr size_t BENCHMARK_WARMUP_FRAMES = 16;
+    static constexpr size_t BENCHMARK_MEASURED_FRAMES = 128;
+
     std::vector<Buffer> mUniformBuffers;
 
     struct UniformBufferObject {
@@ -0,0 +1,131 @@
+#include "ParticleSimulator.h"
+
+#include "Profiler.h"
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PARTICLES_USE_SSE
+#include <emmintrin.h>
+#endif
+
+void ParticleState::Resize(size_t count)
+{
+    PosX.resize(count);
+    PosY.resize(count);
+    VelX.resize(count);
+    VelY.resize(count);
+    Life.resize(count);
+}
+
+ParticleSimulator::ParticleSimulator(JobSystem &jobs) : mJobs(jobs)
+{
+}
+
+// Same logic as in Particle.comp:
+static float MakePeriodic(float pos)
+{
+    if (pos < -1.0f)
+        pos += 2.0f;
+    else if (pos > 1.0f)
+        pos -= 2.0f;
+
+    return pos;
+}
+
+#ifdef PARTICLES_USE_SSE
+static __m128 MakePeriodic(__m128 pos)
+{
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 minusOne = _mm_set1_ps(-1.0f);
+    const __m128 two = _mm_set1_ps(2.0f);
+
+    // At most one of the masks can be set for a given lane:
+    __m128 below = _mm_and_ps(_mm_cmplt_ps(pos, minusOne), two);
+    __m128 above = _mm_and_ps(_mm_cmpgt_ps(pos, one), two);
+
+    return _mm_sub_ps(_mm_add_ps(pos, below), above);
+}
+
+static __m128 Select(__m128 mask, __m128 a, __m128 b)
+{
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+#endif
+
+void ParticleSimulator::StepRange(ParticleState &state, size_t begin, size_t end,
+                                  float speed, float deltaTime)
+{
+    float *posX = state.PosX.data();
+    float *posY = state.PosY.data();
+    const float *velX = state.VelX.data();
+    const float *velY = state.VelY.data();
+    float *life = state.Life.data();
+
+    size_t i = begin;
+
+#ifdef PARTICLES_USE_SSE
+    const __m128 s = _mm_set1_ps(speed);
+    const __m128 dt = _mm_set1_ps(deltaTime);
+    const __m128 zero = _mm_setzero_ps();
+
+    for (; i + 4 <= end; i += 4)
+    {
+        __m128 l = _mm_sub_ps(_mm_loadu_ps(life + i), dt);
+        __m128 alive = _mm_cmpgt_ps(l, zero);
+
+        // Multiplication order matches the shader: (vel * speed) * dt
+        __m128 dx = _mm_mul_ps(_mm_mul_ps(_mm_loadu_ps(velX + i), s), dt);
+        __m128 dy = _mm_mul_ps(_mm_mul_ps(_mm_loadu_ps(velY + i), s), dt);
+
+        __m128 x = _mm_loadu_ps(posX + i);
+        __m128 y = _mm_loadu_ps(posY + i);
+
+        x = Select(alive, MakePeriodic(_mm_add_ps(x, dx)), x);
+        y = Select(alive, MakePeriodic(_mm_add_ps(y, dy)), y);
+
+        _mm_storeu_ps(posX + i, x);
+        _mm_storeu_ps(posY + i, y);
+        _mm_storeu_ps(life + i, _mm_and_ps(alive, l));
+    }
+#endif
+
+    // Scalar remainder (or everything if SSE is unavailable):
+    for (; i < end; i++)
+    {
+        float l = life[i] - deltaTime;
+
+        if (l > 0.0f)
+        {
+            posX[i] = MakePeriodic(posX[i] + velX[i] * speed * deltaTime);
+            posY[i] = MakePeriodic(posY[i] + velY[i] * speed * deltaTime);
+            life[i] = l;
+        }
+        else
+        {
+            life[i] = 0.0f;
+        }
+    }
+}
+
+void ParticleSimulator::Step(ParticleState &state, float speed, float deltaTime)
+{
+    const size_t count = state.Size();
+
+    size_t numChunks = std::min(NumThreads(), count / MIN_PARTICLES_PER_THREAD);
+
+    if (numChunks <= 1)
+    {
+        StepRange(state, 0, count, speed, deltaTime);
+        return;
+    }
+
+    // Keep chunk boundaries aligned to SIMD width:
+    size_t chunkSize = ((count + numChunks - 1) / numChunks + 3) & ~size_t(3);
+
+    // Calling thread takes the first chunk:
+    mJobs.ParallelFor(count, chunkSize, [&](size_t begin, size_t end) {
+        PROFILE_SCOPE("ParticleSimulator::StepRange");
+        StepRange(state, begin, end, speed, deltaTime);
+    });
+}
\ No newline at end of file
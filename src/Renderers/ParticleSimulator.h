@@ -0,0 +1,53 @@
+#pragma once
+
+#include "JobSystem.h"
+
+#include <cstddef>
+#include <vector>
+
+/// Particle data stored as a structure of arrays, to allow SIMD processing.
+struct ParticleState {
+    std::vector<float> PosX;
+    std::vector<float> PosY;
+    std::vector<float> VelX;
+    std::vector<float> VelY;
+    // Remaining lifetime in seconds, particles with Life <= 0 are dead:
+    std::vector<float> Life;
+
+    void Resize(size_t count);
+    [[nodiscard]] size_t Size() const
+    {
+        return PosX.size();
+    }
+};
+
+/**
+    CPU reference implementation of the integrator from Particle.comp
+    (aging, integration and periodic boundary conditions).
+    The update is vectorized (SSE when available, scalar fallback otherwise)
+    and large particle counts are split into jobs of the shared JobSystem.
+*/
+class ParticleSimulator {
+  public:
+    explicit ParticleSimulator(JobSystem &jobs);
+
+    ParticleSimulator(const ParticleSimulator &) = delete;
+    ParticleSimulator &operator=(const ParticleSimulator &) = delete;
+
+    void Step(ParticleState &state, float speed, float deltaTime);
+
+    [[nodiscard]] size_t NumThreads() const
+    {
+        return mJobs.NumThreads();
+    }
+
+    static void StepRange(ParticleState &state, size_t begin, size_t end, float speed,
+                          float deltaTime);
+
+  private:
+    // Below this many particles per thread, waking up workers costs more
+    // than it saves:
+    static constexpr size_t MIN_PARTICLES_PER_THREAD = 4096;
+
+    JobSystem &mJobs;
+};
\ No newline at end of file
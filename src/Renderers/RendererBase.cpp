@@ -1,41 +1,74 @@
 #include "RendererBase.h"
 
+#include <algorithm>
+#include <array>
 #include <cstdint>
+#include <fstream>
+#include <utility>
+#include <vector>
 #include <vulkan/vulkan.h>
 
+#include "Common.h"
+#include "FrameStats.h"
+#include "Profiler.h"
 #include "Utils.h"
 
-RendererBase::RendererBase(VulkanContext &context, std::function<void()> cb)
-    : ctx(context), callback(cb)
+#include "imgui.h"
+
+RendererBase::RendererBase(VulkanContext &context, std::function<void()> cb,
+                           size_t minFramesInFlight)
+    : ctx(context), callback(cb),
+      mFramesInFlight(std::max<size_t>(ctx.Config.FramesInFlight, minFramesInFlight))
 {
     // Create queues
     mGraphicsQueue = utils::GetQueue(ctx, vkb::QueueType::graphics);
     mPresentQueue = utils::GetQueue(ctx, vkb::QueueType::present);
 
     // Create base sync objects
-    mImageAcquiredSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    mRenderCompletedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    mInFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
+    mImageAcquiredSemaphores.resize(mFramesInFlight);
+    mRenderCompletedSemaphores.resize(mFramesInFlight);
+    mFrameTimelineValues.resize(mFramesInFlight, 0);
 
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    for (size_t i = 0; i < mFramesInFlight; i++)
     {
         utils::CreateSemaphore(ctx, mImageAcquiredSemaphores[i]);
         utils::CreateSemaphore(ctx, mRenderCompletedSemaphores[i]);
-        utils::CreateSignalledFence(ctx, mInFlightFences[i]);
+
+        mMainDeletionQueue.push_back(VK_OBJECT_TYPE_SEMAPHORE,
+                                     mImageAcquiredSemaphores[i]);
+        mMainDeletionQueue.push_back(VK_OBJECT_TYPE_SEMAPHORE,
+                                     mRenderCompletedSemaphores[i]);
     }
 
+    // Create per-frame resources
+    mFrames.resize(mFramesInFlight);
+
+    for (auto &frame : mFrames)
+        frame.Init(ctx);
+
     mMainDeletionQueue.push_back([&]() {
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
-        {
-            vkDestroySemaphore(ctx.Device, mRenderCompletedSemaphores[i], nullptr);
-            vkDestroySemaphore(ctx.Device, mImageAcquiredSemaphores[i], nullptr);
-            vkDestroyFence(ctx.Device, mInFlightFences[i], nullptr);
-        }
+        for (auto &frame : mFrames)
+            frame.Destroy(ctx);
     });
+
+    // Create gpu profiler
+    mGpuProfiler.Init(ctx, mFramesInFlight);
+
+    mMainDeletionQueue.push_back([&]() { mGpuProfiler.Destroy(ctx); });
+
+    // Create memory pools, destroyed last as everything else must be freed first:
+    mMemoryPools.Init(ctx);
+
+    mDescriptorAllocator.Init();
 }
 
 RendererBase::~RendererBase()
 {
+    // Renderers are only destroyed once idle:
+    CollectDeferredDeletions(true);
+
+    mDescriptorAllocator.Destroy(ctx);
+    mMemoryPools.Destroy(ctx);
 }
 
 void RendererBase::OnUpdate([[maybe_unused]] float deltatime)
@@ -46,31 +79,195 @@ void RendererBase::OnImGui()
 {
 }
 
+void RendererBase::CreateSwapchainResources()
+{
+}
+
+void RendererBase::OnGpuProfilerImGui()
+{
+    if (!mGpuProfiler.Enabled())
+        return;
+
+    ImGui::Begin("Gpu profiler", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
+
+    ImGui::Checkbox("Show zones", &mShowGpuProfiler);
+
+    if (mShowGpuProfiler)
+    {
+        if (!mGpuProfiler.StatisticsSupported())
+            ImGui::Text("Pipeline statistics not supported");
+
+        for (auto &zone : mGpuProfiler.Results())
+        {
+            ImGui::Text("%s: %.3f ms (avg %.3f ms)", zone.Name.c_str(),
+                        zone.Milliseconds, zone.AverageMilliseconds);
+
+            if (zone.HasStatistics)
+            {
+                ImGui::Text("    vertex: %llu, fragment: %llu, compute: %llu",
+                            static_cast<unsigned long long>(zone.VertexInvocations),
+                            static_cast<unsigned long long>(zone.FragmentInvocations),
+                            static_cast<unsigned long long>(zone.ComputeInvocations));
+            }
+        }
+
+        if (ImGui::Button("Save report"))
+        {
+            std::ofstream file("gpu_profile.txt");
+            file << mGpuProfiler.Report();
+        }
+    }
+
+    ImGui::End();
+}
+
 void RendererBase::OnRender()
 {
+    PROFILE_SCOPE("RendererBase::OnRender");
+
     OnRenderImpl();
-    mFrameSemaphoreIndex = (mFrameSemaphoreIndex + 1) % MAX_FRAMES_IN_FLIGHT;
+    mFrameSemaphoreIndex = (mFrameSemaphoreIndex + 1) % mFramesInFlight;
+}
+
+void RendererBase::WaitForFrames()
+{
+    utils::WaitTimelineValue(ctx, mLastTimelineValue);
+}
+
+void RendererBase::Suspend()
+{
+    WaitForFrames();
+    CollectDeferredDeletions(true);
+    mSwapchainDeletionQueue.flush(ctx);
+
+    // Recreated by the first upload after resuming:
+    for (auto &frame : mFrames)
+        frame.ReleaseUploads(ctx);
+}
+
+void RendererBase::Resume()
+{
+    // Swapchain may have been recreated in the meantime:
+    CreateSwapchainResources();
+}
+
+bool RendererBase::IsIdle() const
+{
+    return utils::CompletedTimelineValue(ctx) >= mLastTimelineValue;
+}
+
+void RendererBase::BeginFrame()
+{
+    // Single wait covers every submission of this slot, compute included:
+    utils::WaitTimelineValue(ctx, mFrameTimelineValues[mFrameSemaphoreIndex]);
+
+    mGpuProfiler.BeginFrame(ctx, mFrameSemaphoreIndex);
+    CurrentFrame().Reset(ctx);
+
+    CollectDeferredDeletions();
+}
+
+bool RendererBase::AcquireFrameImage()
+{
+    auto semaphore = mImageAcquiredSemaphores[mFrameSemaphoreIndex];
+
+    common::AcquireNextImage(ctx, semaphore, mFrameImageIndex);
+
+    return ctx.SwapchainOk;
+}
+
+uint64_t RendererBase::SubmitWork(std::span<VkCommandBuffer> buffers,
+                                  std::span<const VkSemaphoreSubmitInfo> waits)
+{
+    uint64_t value = common::SubmitToTimeline(ctx, mGraphicsQueue, buffers, waits, {});
+
+    mFrameTimelineValues[mFrameSemaphoreIndex] = value;
+    mLastTimelineValue = value;
+
+    return value;
+}
+
+void RendererBase::SubmitFrame(std::span<VkCommandBuffer> buffers,
+                               std::span<const VkSemaphoreSubmitInfo> waits)
+{
+    std::vector<VkSemaphoreSubmitInfo> waitInfos(waits.begin(), waits.end());
+
+    waitInfos.push_back(
+        utils::SemaphoreSubmitInfo(mImageAcquiredSemaphores[mFrameSemaphoreIndex],
+                                   VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT));
+
+    std::array<VkSemaphoreSubmitInfo, 1> signalInfos{
+        utils::SemaphoreSubmitInfo(mRenderCompletedSemaphores[mFrameSemaphoreIndex],
+                                   VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT)};
+
+    uint64_t value =
+        common::SubmitToTimeline(ctx, mGraphicsQueue, buffers, waitInfos, signalInfos);
+
+    mFrameTimelineValues[mFrameSemaphoreIndex] = value;
+    mLastTimelineValue = value;
+
+    // Image was acquired from the current swapchain:
+    ctx.RetireOldSwapchains(value);
+}
+
+void RendererBase::DeferDeletion(std::function<void()> &&deletor)
+{
+    mDeferredDeletionQueue.push_back(mLastTimelineValue, std::move(deletor));
+}
+
+void RendererBase::CollectDeferredDeletions(bool all)
+{
+    if (mDeferredDeletionQueue.empty())
+        return;
+
+    if (all)
+    {
+        mDeferredDeletionQueue.flush(ctx);
+        return;
+    }
+
+    mDeferredDeletionQueue.collect(ctx, utils::CompletedTimelineValue(ctx));
+}
+
+void RendererBase::PresentFrame()
+{
+    common::PresentFrame(ctx, mPresentQueue,
+                         mRenderCompletedSemaphores[mFrameSemaphoreIndex],
+                         mFrameImageIndex);
 }
 
 RenderDataForImGui RendererBase::getImGuiData() const
 {
     return RenderDataForImGui{.Queue = mGraphicsQueue,
                               .FramesInFlight =
-                                  static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT),
+                                  static_cast<uint32_t>(mFramesInFlight),
                               // Temporary, will need to actually fetch it from
                               // derived class:
-                              .MSAA = VK_SAMPLE_COUNT_1_BIT};
+                              .MSAA = VK_SAMPLE_COUNT_1_BIT,
+                              .ColorFormat = ctx.Swapchain.image_format,
+                              .DepthFormat = mDepthFormat};
 }
 
 void RendererBase::RecreateSwapchain()
 {
-    vkDeviceWaitIdle(ctx.Device);
+    ScopedFramePhase phase(FramePhase::SwapchainRecreation);
+
+    // Frames in flight may still use the old swapchain and extent dependent
+    // resources, so both are retired instead of waiting for the device:
+    auto oldExtent = ctx.Swapchain.extent;
 
-    mSwapchainDeletionQueue.flush();
     ctx.CreateSwapchain(ctx.Width, ctx.Height);
-    CreateSwapchainResources();
 
-    ctx.SwapchainOk = true;
+    auto extent = ctx.Swapchain.extent;
 
-    // OnRender();
+    if (extent.width != oldExtent.width || extent.height != oldExtent.height)
+    {
+        mDeferredDeletionQueue.push_back(mLastTimelineValue,
+                                         std::move(mSwapchainDeletionQueue));
+
+        CreateSwapchainResources();
+    }
+
+    ctx.SwapchainOk = true;
+    ctx.SwapchainSuboptimal = false;
 }
\ No newline at end of file
@@ -1,15 +1,26 @@
 #pragma once
 
 #include "DeletionQueue.h"
+#include "Descriptor.h"
+#include "FrameContext.h"
+#include "GpuProfiler.h"
+#include "MemoryPools.h"
 #include "VulkanContext.h"
 
+#include <cstdint>
 #include <functional>
+#include <span>
+#include <vector>
 
 /// Struct containing data needed for ImGuiContext
 struct RenderDataForImGui {
     VkQueue Queue;
     uint32_t FramesInFlight;
     VkSampleCountFlagBits MSAA;
+    VkFormat ColorFormat;
+    VkFormat DepthFormat;
+
+    bool operator==(const RenderDataForImGui &) const = default;
 };
 
 /**
@@ -21,27 +32,74 @@ struct RenderDataForImGui {
 */
 class RendererBase {
   public:
-    RendererBase(VulkanContext &context, std::function<void()> cb);
+    RendererBase(VulkanContext &context, std::function<void()> cb,
+                 size_t minFramesInFlight = 1);
 
     virtual ~RendererBase();
 
     virtual void OnUpdate([[maybe_unused]] float deltatime);
     virtual void OnImGui();
+    void OnGpuProfilerImGui();
     void OnRender();
     void RecreateSwapchain();
 
+    // Waits only for this renderer's frames in flight, not the whole device:
+    void WaitForFrames();
+    // Checks whether all submitted work of this renderer has finished:
+    [[nodiscard]] bool IsIdle() const;
+
+    // Releases per-swapchain resources, while keeping everything else alive:
+    void Suspend();
+    void Resume();
+
     [[nodiscard]] RenderDataForImGui getImGuiData() const;
 
   protected:
     virtual void OnRenderImpl() = 0;
 
-    virtual void CreateSwapchainResources() = 0;
+    // Resources depending on the swapchain extent, recreated only when it changes:
+    virtual void CreateSwapchainResources();
+
+    // Frame synchronization shared by all renderers, keyed by values
+    // of the graphics timeline (see VulkanContext::GraphicsTimeline).
+
+    // Waits until work previously submitted in the current frame slot has finished,
+    // then recycles its FrameContext:
+    void BeginFrame();
+    // Returns false if the swapchain needs to be recreated:
+    bool AcquireFrameImage();
+    // Submits work that is not presented (e.g. compute), returns its timeline value:
+    uint64_t SubmitWork(std::span<VkCommandBuffer> buffers,
+                        std::span<const VkSemaphoreSubmitInfo> waits = {});
+    // Submits the frame, waiting for the acquired image and signalling render completion:
+    void SubmitFrame(std::span<VkCommandBuffer> buffers,
+                     std::span<const VkSemaphoreSubmitInfo> waits = {});
+    void PresentFrame();
+
+    FrameContext &CurrentFrame()
+    {
+        return mFrames[mFrameSemaphoreIndex];
+    }
+
+    // Defers deletion until all work submitted by this renderer so far has finished,
+    // for replacing objects the frames in flight may still use:
+    void DeferDeletion(std::function<void()> &&deletor);
+
+    template <typename Handle>
+    void DeferDeletion(VkObjectType type, Handle handle,
+                       VmaAllocation allocation = VK_NULL_HANDLE)
+    {
+        mDeferredDeletionQueue.push_back(mLastTimelineValue, type, handle, allocation);
+    }
+    // Runs deferred deletors the GPU is done with:
+    void CollectDeferredDeletions(bool all = false);
 
   protected:
     VulkanContext &ctx;
     std::function<void()> callback;
 
-    const size_t MAX_FRAMES_IN_FLIGHT = 2;
+    // Fixed for the lifetime of a renderer, read from ctx.Config:
+    const size_t mFramesInFlight;
 
     VkQueue mGraphicsQueue;
     VkQueue mPresentQueue;
@@ -49,11 +107,33 @@ class RendererBase {
     std::vector<VkSemaphore> mImageAcquiredSemaphores;
     std::vector<VkSemaphore> mRenderCompletedSemaphores;
 
-    std::vector<VkFence> mInFlightFences;
+    std::vector<FrameContext> mFrames;
+
+    // Timeline value of the last submission made in each frame slot:
+    std::vector<uint64_t> mFrameTimelineValues;
+    // Timeline value of the last submission made by this renderer:
+    uint64_t mLastTimelineValue = 0;
+
+    // Format of the depth attachment bound when recording imgui,
+    // VK_FORMAT_UNDEFINED if there is none:
+    VkFormat mDepthFormat = VK_FORMAT_UNDEFINED;
 
     size_t mFrameSemaphoreIndex = 0;
     uint32_t mFrameImageIndex = 0;
 
+    GpuProfiler mGpuProfiler;
+    bool mShowGpuProfiler = false;
+
+    // Static geometry and textures of the renderer, released together:
+    MemoryPools mMemoryPools;
+    // Descriptor sets living as long as the renderer, per-frame ones
+    // come from CurrentFrame().Descriptors instead:
+    DescriptorAllocator mDescriptorAllocator;
+
     DeletionQueue mMainDeletionQueue;
     DeletionQueue mSwapchainDeletionQueue;
+
+    // Deletors usually capture the renderer, so unlike ctx.DeferredDeletions
+    // this queue is flushed at the latest when the renderer is destroyed:
+    DeferredDeletionQueue mDeferredDeletionQueue;
 };
\ No newline at end of file
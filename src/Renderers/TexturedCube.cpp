@@ -9,6 +9,8 @@
 #include "Sampler.h"
 #include "Shader.h"
 
+#include "Profiler.h"
+
 #include "ImGuiContext.h"
 #include "imgui.h"
 
@@ -32,29 +34,32 @@ TexturedCubeRenderer::TexturedCubeRenderer(VulkanContext &ctx,
                                            std::function<void()> callback)
     : RendererBase(ctx, callback)
 {
+    mDepthFormat = utils::FindDepthFormat(ctx);
+
     CreateDescriptorSets();
     CreateGraphicsPipelines();
+    CreateCommandPools();
     CreateSwapchainResources();
     CreateTextureResources();
-    CreateVertexBuffers();
-    CreateIndexBuffers();
+    CreateMesh();
     CreateUniformBuffers();
     UpdateDescriptorSets();
 }
 
 TexturedCubeRenderer::~TexturedCubeRenderer()
 {
-    mSwapchainDeletionQueue.flush();
-    mMainDeletionQueue.flush();
+    mSwapchainDeletionQueue.flush(ctx);
+    mMainDeletionQueue.flush(ctx);
 }
 
 void TexturedCubeRenderer::OnUpdate([[maybe_unused]] float deltatime)
 {
     // Update Uniform buffer data:
-    auto width = static_cast<float>(ctx.Swapchain.extent.width);
-    auto height = static_cast<float>(ctx.Swapchain.extent.height);
+    auto width = static_cast<float>(ctx.GetRenderExtent().width);
+    auto height = static_cast<float>(ctx.GetRenderExtent().height);
 
-    float aspect = width / height;
+    // Extent is zero while minimized:
+    float aspect = height > 0.0f ? width / height : 1.0f;
 
     glm::vec3 pos{0.0f, 0.0f, -3.0f};
     glm::vec3 front{0.0f, 0.0f, 1.0f};
@@ -82,47 +87,34 @@ void TexturedCubeRenderer::OnImGui()
 
 void TexturedCubeRenderer::OnRenderImpl()
 {
-    auto &imageAcquiredSemaphore = mImageAcquiredSemaphores[mFrameSemaphoreIndex];
-    auto &renderCompleteSemaphore = mRenderCompletedSemaphores[mFrameSemaphoreIndex];
-    auto &fence = mInFlightFences[mFrameSemaphoreIndex];
+    PROFILE_SCOPE("TexturedCubeRenderer::OnRenderImpl");
 
-    vkWaitForFences(ctx.Device, 1, &fence, VK_TRUE, UINT64_MAX);
+    BeginFrame();
 
-    common::AcquireNextImage(ctx, imageAcquiredSemaphore, mFrameImageIndex);
-
-    if (!ctx.SwapchainOk)
+    if (!AcquireFrameImage())
         return;
 
-    vkResetFences(ctx.Device, 1, &fence);
-
     // DrawFrame
     {
-        auto &buffer = mCommandBuffers[mFrameSemaphoreIndex];
+        auto buffer = CurrentFrame().AllocateCommandBuffer(ctx);
 
-        vkResetCommandBuffer(buffer, 0);
         RecordCommandBuffer(buffer, mFrameImageIndex);
 
         auto buffers = std::array<VkCommandBuffer, 1>{buffer};
 
-        common::SubmitGraphicsQueueDefault(mGraphicsQueue, buffers, fence,
-                                           imageAcquiredSemaphore,
-                                           renderCompleteSemaphore);
+        SubmitFrame(buffers);
     }
 
-    common::PresentFrame(ctx, mPresentQueue, renderCompleteSemaphore, mFrameImageIndex);
+    PresentFrame();
 }
 
 void TexturedCubeRenderer::CreateSwapchainResources()
 {
     CreateDepthResources();
-    CreateCommandPools();
-    CreateCommandBuffers();
 }
 
 void TexturedCubeRenderer::CreateDescriptorSets()
 {
-    auto numFrames = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
-
     // Descriptor layout
     mDescriptorSetLayout =
         DescriptorSetLayoutBuilder()
@@ -131,90 +123,71 @@ void TexturedCubeRenderer::CreateDescriptorSets()
                         VK_SHADER_STAGE_FRAGMENT_BIT)
             .Build(ctx);
 
-    // Descriptor pool
-    std::vector<PoolCount> poolCounts{
-        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, numFrames},
-        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, numFrames},
-    };
-    uint32_t maxSets = numFrames;
-
-    mDescriptorPool = Descriptor::InitPool(ctx, maxSets, poolCounts);
-
     // Descriptor sets allocation
-    std::vector<VkDescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT,
+    std::vector<VkDescriptorSetLayout> layouts(mFramesInFlight,
                                                mDescriptorSetLayout);
 
-    mDescriptorSets = Descriptor::Allocate(ctx, mDescriptorPool, layouts);
-
-    mMainDeletionQueue.push_back([&]() {
-        vkDestroyDescriptorPool(ctx.Device, mDescriptorPool, nullptr);
-        vkDestroyDescriptorSetLayout(ctx.Device, mDescriptorSetLayout, nullptr);
-    });
+    mDescriptorSets = mDescriptorAllocator.Allocate(ctx, layouts);
 }
 
 void TexturedCubeRenderer::CreateGraphicsPipelines()
 {
-    auto shaderStages = ShaderBuilder()
-                            .SetVertexPath("assets/spirv/TexturedCubeVert.spv")
-                            .SetFragmentPath("assets/spirv/TexturedCubeFrag.spv")
-                            .Build(ctx);
+    bool pulling = ctx.Config.VertexPulling;
+
+    auto shaderStages =
+        ShaderBuilder()
+            .SetVertexPath(pulling ? "assets/spirv/TexturedCubePulledVert.spv"
+                                   : "assets/spirv/TexturedCubeVert.spv")
+            .SetFragmentPath("assets/spirv/TexturedCubeFrag.spv")
+            .Build(ctx);
 
     auto bindingDescription =
         utils::GetBindingDescription<Vertex>(0, VK_VERTEX_INPUT_RATE_VERTEX);
     auto attributeDescriptions = Vertex::getAttributeDescriptions();
 
-    VkFormat depthFormat = utils::FindDepthFormat(ctx);
-
-    mGraphicsPipeline = PipelineBuilder()
-                            .SetShaderStages(shaderStages)
-                            .SetVertexInput(bindingDescription, attributeDescriptions)
-                            .SetTopology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST)
-                            .SetPolygonMode(VK_POLYGON_MODE_FILL)
-                            .SetCullMode(VK_CULL_MODE_BACK_BIT, VK_FRONT_FACE_CLOCKWISE)
-                            .EnableDepthTest()
-                            .SetSwapchainColorFormat(ctx.Swapchain.image_format)
-                            .SetDepthFormat(depthFormat)
-                            .Build(ctx, mDescriptorSetLayout);
-
-    mMainDeletionQueue.push_back([&]() {
-        vkDestroyPipeline(ctx.Device, mGraphicsPipeline.Handle, nullptr);
-        vkDestroyPipelineLayout(ctx.Device, mGraphicsPipeline.Layout, nullptr);
-    });
+    auto builder = PipelineBuilder()
+                       .SetShaderStages(shaderStages)
+                       .SetTopology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST)
+                       .SetPolygonMode(VK_POLYGON_MODE_FILL)
+                       .SetCullMode(VK_CULL_MODE_BACK_BIT, VK_FRONT_FACE_CLOCKWISE)
+                       .EnableDepthTest()
+                       .SetSwapchainColorFormat(ctx.Swapchain.image_format)
+                       .SetDepthFormat(mDepthFormat);
+
+    // Pulled vertices need no vertex input state:
+    if (pulling)
+        builder.SetPushConstants(VK_SHADER_STAGE_VERTEX_BIT,
+                                 sizeof(GeometryArena::PullConstants));
+    else
+        builder.SetVertexInput(bindingDescription, attributeDescriptions);
+
+    mGraphicsPipeline = builder.Build(ctx, mDescriptorSetLayout);
+
+    mMainDeletionQueue.push_back(VK_OBJECT_TYPE_PIPELINE, mGraphicsPipeline.Handle);
+    mMainDeletionQueue.push_back(VK_OBJECT_TYPE_PIPELINE_LAYOUT,
+                                 mGraphicsPipeline.Layout);
 }
 
 void TexturedCubeRenderer::CreateCommandPools()
 {
     VkCommandPoolCreateInfo pool_info = {};
     pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-    pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    // Only used for one-off upload commands, frame commands come from FrameContext:
+    pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
     pool_info.queueFamilyIndex =
         ctx.Device.get_queue_index(vkb::QueueType::graphics).value();
 
     if (vkCreateCommandPool(ctx.Device, &pool_info, nullptr, &mCommandPool) != VK_SUCCESS)
         throw std::runtime_error("Failed to create a command pool!");
 
-    mSwapchainDeletionQueue.push_back(
-        [&]() { vkDestroyCommandPool(ctx.Device, mCommandPool, nullptr); });
-}
-
-void TexturedCubeRenderer::CreateCommandBuffers()
-{
-    mCommandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-
-    VkCommandBufferAllocateInfo allocInfo = {};
-    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.commandPool = mCommandPool;
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandBufferCount = static_cast<uint32_t>(mCommandBuffers.size());
-
-    if (vkAllocateCommandBuffers(ctx.Device, &allocInfo, mCommandBuffers.data()) !=
-        VK_SUCCESS)
-        throw std::runtime_error("Failed to allocate command buffers!");
+    mMainDeletionQueue.push_back(VK_OBJECT_TYPE_COMMAND_POOL, mCommandPool);
 }
 
 void TexturedCubeRenderer::RecordCommandBuffer(VkCommandBuffer commandBuffer,
                                                uint32_t imageIndex)
 {
+    PROFILE_SCOPE("TexturedCubeRenderer::RecordCommandBuffer");
+
     VkCommandBufferBeginInfo begin_info = {};
     begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 
@@ -257,19 +230,27 @@ void TexturedCubeRenderer::RecordCommandBuffer(VkCommandBuffer commandBuffer,
 
         common::ViewportScissorDefaultBehaviour(ctx, commandBuffer);
 
-        std::array<VkBuffer, 1> vertexBuffers{mVertexBuffer.Handle};
-        std::array<VkDeviceSize, 1> offsets{0};
-        vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers.data(), offsets.data());
+        ctx.Geometry->Bind(commandBuffer);
 
-        vkCmdBindIndexBuffer(commandBuffer, mIndexBuffer.Handle, 0, VK_INDEX_TYPE_UINT16);
+        if (ctx.Config.VertexPulling)
+            ctx.Geometry->PushPullConstants(commandBuffer, mGraphicsPipeline.Layout,
+                                            sizeof(Vertex));
 
         vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
                                 mGraphicsPipeline.Layout, 0, 1,
                                 &mDescriptorSets[mFrameSemaphoreIndex], 0, nullptr);
 
-        vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(mIndexCount), 1, 0, 0, 0);
+        {
+            GpuZone zone(mGpuProfiler, commandBuffer, "Scene", true);
+
+            vkCmdDrawIndexed(commandBuffer, mMesh.IndexCount, 1, mMesh.FirstIndex,
+                             mMesh.VertexOffset, 0);
+        }
 
-        ImGuiContextManager::RecordImguiToCommandBuffer(commandBuffer);
+        {
+            GpuZone zone(mGpuProfiler, commandBuffer, "ImGui");
+            ImGuiContextManager::RecordImguiToCommandBuffer(commandBuffer);
+        }
     }
 
     vkCmdEndRendering(commandBuffer);
@@ -280,7 +261,7 @@ void TexturedCubeRenderer::RecordCommandBuffer(VkCommandBuffer commandBuffer,
         throw std::runtime_error("Failed to record command buffer!");
 }
 
-void TexturedCubeRenderer::CreateVertexBuffers()
+void TexturedCubeRenderer::CreateMesh()
 {
     // clang-format off
     const std::vector<Vertex> vertices = {
@@ -316,26 +297,8 @@ void TexturedCubeRenderer::CreateVertexBuffers()
     };
     // clang-format on
 
-    mVertexCount = vertices.size();
-
-    GPUBufferInfo info{
-        .Queue = mGraphicsQueue,
-        .Pool = mCommandPool,
-        .Data = vertices.data(),
-        .Size = mVertexCount * sizeof(Vertex),
-        .Usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-        .Properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-    };
-
-    mVertexBuffer = Buffer::CreateGPUBuffer(ctx, info);
-
-    mMainDeletionQueue.push_back([&]() { Buffer::DestroyBuffer(ctx, mVertexBuffer); });
-}
-
-void TexturedCubeRenderer::CreateIndexBuffers()
-{
     // clang-format off
-    const std::vector<uint16_t> indices = {
+    const std::vector<uint32_t> indices = {
         0, 2, 1, 2, 0, 3,
         4, 5, 6, 6, 7, 4,
         8, 9, 10, 10, 11, 8,
@@ -345,35 +308,24 @@ void TexturedCubeRenderer::CreateIndexBuffers()
     };
     // clang-format on
 
-    mIndexCount = indices.size();
+    mMesh = ctx.Geometry->Upload(mGraphicsQueue, mCommandPool, vertices, indices);
 
-    GPUBufferInfo info{
-        .Queue = mGraphicsQueue,
-        .Pool = mCommandPool,
-        .Data = indices.data(),
-        .Size = mIndexCount * sizeof(uint16_t),
-        .Usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-        .Properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-    };
-
-    mIndexBuffer = Buffer::CreateGPUBuffer(ctx, info);
-
-    mMainDeletionQueue.push_back([&]() { Buffer::DestroyBuffer(ctx, mIndexBuffer); });
+    mMainDeletionQueue.push_back([&]() { ctx.Geometry->Free(mMesh); });
 }
 
 void TexturedCubeRenderer::CreateUniformBuffers()
 {
     VkDeviceSize bufferSize = sizeof(UniformBufferObject);
 
-    mUniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+    mUniformBuffers.resize(mFramesInFlight);
 
     for (auto &uniformBuffer : mUniformBuffers)
+    {
         uniformBuffer = Buffer::CreateMappedUniformBuffer(ctx, bufferSize);
 
-    mMainDeletionQueue.push_back([&]() {
-        for (auto &uniformBuffer : mUniformBuffers)
-            Buffer::DestroyBuffer(ctx, uniformBuffer);
-    });
+        mMainDeletionQueue.push_back(VK_OBJECT_TYPE_BUFFER, uniformBuffer.Handle,
+                                     uniformBuffer.Allocation);
+    }
 }
 
 void TexturedCubeRenderer::UpdateDescriptorSets()
@@ -419,6 +371,7 @@ void TexturedCubeRenderer::CreateTextureResources()
         .Queue = mGraphicsQueue,
         .Pool = mCommandPool,
         .Filepath = "assets/textures/container.jpg",
+        .MemoryPool = mMemoryPools.Textures,
     };
 
     mTextureImage = ImageLoaders::LoadImage2D(ctx, info);
@@ -432,21 +385,18 @@ void TexturedCubeRenderer::CreateTextureResources()
                           .SetAddressMode(VK_SAMPLER_ADDRESS_MODE_REPEAT)
                           .Build(ctx);
 
-    mMainDeletionQueue.push_back([&]() {
-        vkDestroySampler(ctx.Device, mTextureSampler, nullptr);
-        vkDestroyImageView(ctx.Device, mTextureImageView, nullptr);
-        Image::DestroyImage(ctx, mTextureImage);
-    });
+    mMainDeletionQueue.push_back(VK_OBJECT_TYPE_IMAGE, mTextureImage.Handle,
+                                 mTextureImage.Allocation);
+    mMainDeletionQueue.push_back(VK_OBJECT_TYPE_IMAGE_VIEW, mTextureImageView);
+    mMainDeletionQueue.push_back(VK_OBJECT_TYPE_SAMPLER, mTextureSampler);
 }
 
 void TexturedCubeRenderer::CreateDepthResources()
 {
-    VkFormat depthFormat = utils::FindDepthFormat(ctx);
-
     ImageInfo info{
         .Width = ctx.Swapchain.extent.width,
         .Height = ctx.Swapchain.extent.height,
-        .Format = depthFormat,
+        .Format = mDepthFormat,
         .Tiling = VK_IMAGE_TILING_OPTIMAL,
         .Usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
         .Properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
@@ -454,11 +404,12 @@ void TexturedCubeRenderer::CreateDepthResources()
 
     mDepthImage = Image::CreateImage(ctx, info);
 
-    mDepthImageView = ImageView::Create(ctx, mDepthImage.Handle, depthFormat,
+    mDepthImageView = ImageView::Create(ctx, mDepthImage.Handle, mDepthFormat,
                                         VK_IMAGE_ASPECT_DEPTH_BIT);
 
-    mSwapchainDeletionQueue.push_back([&]() {
-        vkDestroyImageView(ctx.Device, mDepthImageView, nullptr);
-        Image::DestroyImage(ctx, mDepthImage);
-    });
+    // Stored by value, since recreation may retire these while new
+    // ones are already in use:
+    mSwapchainDeletionQueue.push_back(VK_OBJECT_TYPE_IMAGE, mDepthImage.Handle,
+                                      mDepthImage.Allocation);
+    mSwapchainDeletionQueue.push_back(VK_OBJECT_TYPE_IMAGE_VIEW, mDepthImageView);
 }
\ No newline at end of file
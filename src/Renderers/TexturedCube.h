@@ -3,6 +3,7 @@
 #include "RendererBase.h"
 
 #include "Buffer.h"
+#include "GeometryArena.h"
 #include "Image.h"
 #include "Pipeline.h"
 
@@ -27,10 +28,8 @@ class TexturedCubeRenderer : public RendererBase {
     void CreateGraphicsPipelines();
 
     void CreateCommandPools();
-    void CreateCommandBuffers();
 
-    void CreateVertexBuffers();
-    void CreateIndexBuffers();
+    void CreateMesh();
     void CreateUniformBuffers();
 
     void CreateTextureResources();
@@ -39,14 +38,13 @@ class TexturedCubeRenderer : public RendererBase {
     void RecordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex);
 
   private:
+    // Shared through ctx.DescriptorLayouts:
     VkDescriptorSetLayout mDescriptorSetLayout;
-    VkDescriptorPool mDescriptorPool;
     std::vector<VkDescriptorSet> mDescriptorSets;
 
     Pipeline mGraphicsPipeline;
 
     VkCommandPool mCommandPool;
-    std::vector<VkCommandBuffer> mCommandBuffers;
 
     struct Vertex {
         glm::vec3 Pos;
@@ -55,11 +53,8 @@ class TexturedCubeRenderer : public RendererBase {
         static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
     };
 
-    Buffer mVertexBuffer;
-    size_t mVertexCount;
-
-    Buffer mIndexBuffer;
-    size_t mIndexCount;
+    // Suballocated from ctx.Geometry:
+    GeometryArena::Mesh mMesh;
 
     std::vector<Buffer> mUniformBuffers;
 
@@ -3,6 +3,7 @@
 #include "RendererBase.h"
 
 #include "Buffer.h"
+#include "GeometryArena.h"
 #include "Image.h"
 #include "Pipeline.h"
 
@@ -18,19 +19,14 @@ class TexturedQuadRenderer : public RendererBase {
     void OnImGui() override;
     void OnRenderImpl() override;
 
-  private:
-    void CreateSwapchainResources() override;
-
   private:
     void CreateDescriptorSets();
     void UpdateDescriptorSets();
     void CreateGraphicsPipelines();
 
     void CreateCommandPools();
-    void CreateCommandBuffers();
 
-    void CreateVertexBuffers();
-    void CreateIndexBuffers();
+    void CreateMesh();
     void CreateUniformBuffers();
 
     void CreateTextureResources();
@@ -38,14 +34,13 @@ class TexturedQuadRenderer : public RendererBase {
     void RecordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex);
 
   private:
+    // Shared through ctx.DescriptorLayouts:
     VkDescriptorSetLayout mDescriptorSetLayout;
-    VkDescriptorPool mDescriptorPool;
     std::vector<VkDescriptorSet> mDescriptorSets;
 
     Pipeline mGraphicsPipeline;
 
     VkCommandPool mCommandPool;
-    std::vector<VkCommandBuffer> mCommandBuffers;
 
     struct Vertex {
         glm::vec2 Pos;
@@ -54,11 +49,8 @@ class TexturedQuadRenderer : public RendererBase {
         static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
     };
 
-    Buffer mVertexBuffer;
-    size_t mVertexCount;
-
-    Buffer mIndexBuffer;
-    size_t mIndexCount;
+    // Suballocated from ctx.Geometry:
+    GeometryArena::Mesh mMesh;
 
     std::vector<Buffer> mUniformBuffers;
 
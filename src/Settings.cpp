@@ -0,0 +1,104 @@
+#include "Settings.h"
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+static constexpr std::array<std::pair<const char *, VkPresentModeKHR>, 4> PresentModes{{
+    {"fifo", VK_PRESENT_MODE_FIFO_KHR},
+    {"mailbox", VK_PRESENT_MODE_MAILBOX_KHR},
+    {"immediate", VK_PRESENT_MODE_IMMEDIATE_KHR},
+    {"fifo_relaxed", VK_PRESENT_MODE_FIFO_RELAXED_KHR},
+}};
+
+static uint32_t ParseCount(const std::string &option, const std::string &value)
+{
+    try
+    {
+        size_t pos = 0;
+        int count = std::stoi(value, &pos);
+
+        if (pos == value.size() && count >= 0)
+            return static_cast<uint32_t>(count);
+    }
+    catch (const std::logic_error &)
+    {
+    }
+
+    throw std::runtime_error("Invalid value for " + option + ": " + value);
+}
+
+Settings Settings::FromCommandLine(int argc, char *argv[])
+{
+    Settings settings;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string option = argv[i];
+
+        // Flags without a value:
+        if (option == "--job-benchmark")
+        {
+            settings.JobBenchmark = true;
+            continue;
+        }
+
+        if (option == "--vertex-pulling")
+        {
+            settings.VertexPulling = true;
+            continue;
+        }
+
+        if (i + 1 >= argc)
+            throw std::runtime_error("Missing value for option: " + option);
+
+        std::string value = argv[++i];
+
+        if (option == "--frames-in-flight")
+        {
+            settings.FramesInFlight = ParseCount(option, value);
+
+            if (settings.FramesInFlight < MIN_FRAMES_IN_FLIGHT ||
+                settings.FramesInFlight > MAX_FRAMES_IN_FLIGHT)
+                throw std::runtime_error("Frames in flight must be between 1 and 4!");
+        }
+        else if (option == "--swapchain-images")
+        {
+            settings.SwapchainImages = ParseCount(option, value);
+        }
+        else if (option == "--present-mode")
+        {
+            auto it = std::find_if(PresentModes.begin(), PresentModes.end(),
+                                   [&](const auto &mode) { return value == mode.first; });
+
+            if (it == PresentModes.end())
+                throw std::runtime_error("Unknown present mode: " + value);
+
+            settings.PresentMode = it->second;
+        }
+        else if (option == "--vma-dump")
+        {
+            settings.VmaDumpPath = value;
+            settings.VmaDumpOnExit = true;
+        }
+        else
+        {
+            throw std::runtime_error("Unknown option: " + option);
+        }
+    }
+
+    return settings;
+}
+
+const char *Settings::PresentModeName(VkPresentModeKHR mode)
+{
+    for (auto &[name, presentMode] : PresentModes)
+    {
+        if (presentMode == mode)
+            return name;
+    }
+
+    return "unknown";
+}
\ No newline at end of file
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <string>
+
+/// Options given on the command line, frame pacing ones are also adjustable at runtime.
+struct Settings {
+    static constexpr uint32_t MIN_FRAMES_IN_FLIGHT = 1;
+    static constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 4;
+
+    // Fewer frames lower the latency, more allow better CPU/GPU overlap:
+    uint32_t FramesInFlight = 2;
+    // Minimum swapchain image count, 0 leaves the choice to vk-bootstrap:
+    uint32_t SwapchainImages = 0;
+    // Falls back to FIFO if not supported by the surface:
+    VkPresentModeKHR PresentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+
+    // Runs the job system micro-benchmark instead of the application:
+    bool JobBenchmark = false;
+
+    // VMA statistics json, written on F10 and (if requested) before exiting:
+    std::string VmaDumpPath = "vma_stats.json";
+    bool VmaDumpOnExit = false;
+
+    // Vertex shaders fetch vertices through buffer device address instead of
+    // fixed-function vertex input:
+    bool VertexPulling = false;
+
+    // Accepts --frames-in-flight <1-4>, --swapchain-images <n>,
+    // --present-mode <fifo|mailbox|immediate|fifo_relaxed>, --vma-dump <path>,
+    // --vertex-pulling and --job-benchmark:
+    static Settings FromCommandLine(int argc, char *argv[]);
+
+    static const char *PresentModeName(VkPresentModeKHR mode);
+};
\ No newline at end of file
@@ -60,6 +60,11 @@ void SystemWindow::WaitEvents()
     glfwWaitEvents();
 }
 
+void SystemWindow::WaitEventsTimeout(double seconds)
+{
+    glfwWaitEventsTimeout(seconds);
+}
+
 VkSurfaceKHR SystemWindow::CreateSurface(VkInstance instance,
                                          VkAllocationCallbacks *allocator)
 {
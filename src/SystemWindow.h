@@ -19,6 +19,7 @@ class SystemWindow {
 
     void PollEvents();
     void WaitEvents();
+    void WaitEventsTimeout(double seconds);
 
     GLFWwindow *get()
     {
@@ -0,0 +1,209 @@
+#include "Autotuner.h"
+
+#include "Utils.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <limits>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+
+static constexpr const char *CACHE_PATH = "autotune.cache";
+
+static std::string DeviceKey(VulkanContext &ctx)
+{
+    auto &props = ctx.PhysicalDevice.properties;
+
+    std::ostringstream key;
+    key << std::hex << props.vendorID << ':' << props.deviceID << ':'
+        << props.driverVersion;
+
+    return key.str();
+}
+
+static std::optional<uint32_t> ReadCache(const std::string &device,
+                                         const std::string &name)
+{
+    std::ifstream file(CACHE_PATH);
+
+    std::string entryDevice, entryName;
+    uint32_t value;
+
+    while (file >> entryDevice >> entryName >> value)
+    {
+        if (entryDevice == device && entryName == name)
+            return value;
+    }
+
+    return std::nullopt;
+}
+
+static void WriteCache(const std::string &device, const std::string &name,
+                       uint32_t value)
+{
+    std::vector<std::string> lines;
+
+    {
+        std::ifstream file(CACHE_PATH);
+        std::string line;
+
+        while (std::getline(file, line))
+        {
+            std::istringstream entry(line);
+            std::string entryDevice, entryName;
+            entry >> entryDevice >> entryName;
+
+            if (!(entryDevice == device && entryName == name) && !line.empty())
+                lines.push_back(line);
+        }
+    }
+
+    std::ofstream file(CACHE_PATH, std::ios::trunc);
+
+    for (auto &line : lines)
+        file << line << '\n';
+
+    file << device << ' ' << name << ' ' << value << '\n';
+}
+
+WorkgroupTuningResult Autotuner::FindWorkgroupSize(VulkanContext &ctx,
+                                                   const WorkgroupTuningInfo &info)
+{
+    auto &limits = ctx.PhysicalDevice.properties.limits;
+
+    std::vector<uint32_t> candidates;
+
+    for (auto size : info.Candidates)
+    {
+        if (size <= limits.maxComputeWorkGroupSize[0] &&
+            size <= limits.maxComputeWorkGroupInvocations)
+            candidates.push_back(size);
+    }
+
+    if (candidates.empty())
+        throw std::runtime_error("No supported workgroup size for " + info.Name);
+
+    auto device = DeviceKey(ctx);
+
+    if (!info.IgnoreCache)
+    {
+        auto cached = ReadCache(device, info.Name);
+
+        // Cached size may be stale if candidates changed:
+        if (cached.has_value() &&
+            std::find(candidates.begin(), candidates.end(), *cached) != candidates.end())
+            return WorkgroupTuningResult{.WorkgroupSize = *cached, .FromCache = true};
+    }
+
+    if (info.CacheOnly)
+        return WorkgroupTuningResult{.WorkgroupSize = candidates.front(),
+                                     .Pending = true};
+
+    auto family = ctx.Device.get_queue_index(vkb::QueueType::graphics).value();
+    auto validBits = ctx.PhysicalDevice.get_queue_families()[family].timestampValidBits;
+
+    // Software implementations may not support timestamps:
+    const bool useTimestamps = limits.timestampComputeAndGraphics && validBits != 0;
+    const uint64_t timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+    VkQueryPool queryPool = VK_NULL_HANDLE;
+
+    if (useTimestamps)
+    {
+        VkQueryPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        poolInfo.queryCount = 2;
+
+        if (vkCreateQueryPool(ctx.Device, &poolInfo, nullptr, &queryPool) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create a query pool!");
+    }
+
+    // Best of several submissions, to filter out scheduling noise:
+    constexpr size_t repeats = 3;
+
+    WorkgroupTuningResult result{};
+    float bestTime = std::numeric_limits<float>::max();
+
+    for (auto size : candidates)
+    {
+        Pipeline pipeline = info.BuildPipeline(size);
+
+        // Warm-up, first submission may include lazy driver work:
+        {
+            utils::ScopedCommand cmd(ctx, info.Queue, info.Pool);
+            info.RecordDispatch(cmd.Buffer, pipeline, size);
+        }
+
+        float time = std::numeric_limits<float>::max();
+
+        for (size_t rep = 0; rep < repeats; rep++)
+        {
+            auto start = std::chrono::high_resolution_clock::now();
+
+            {
+                utils::ScopedCommand cmd(ctx, info.Queue, info.Pool);
+
+                if (useTimestamps)
+                {
+                    vkCmdResetQueryPool(cmd.Buffer, queryPool, 0, 2);
+                    vkCmdWriteTimestamp(cmd.Buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                                        queryPool, 0);
+                }
+
+                for (uint32_t i = 0; i < info.Iterations; i++)
+                    info.RecordDispatch(cmd.Buffer, pipeline, size);
+
+                if (useTimestamps)
+                    vkCmdWriteTimestamp(cmd.Buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                                        queryPool, 1);
+            }
+
+            auto end = std::chrono::high_resolution_clock::now();
+
+            float elapsed;
+
+            if (useTimestamps)
+            {
+                std::array<uint64_t, 2> timestamps{};
+
+                vkGetQueryPoolResults(ctx.Device, queryPool, 0, 2, sizeof(timestamps),
+                                      timestamps.data(), sizeof(uint64_t),
+                                      VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+
+                // Bits above timestampValidBits are undefined, counter may also wrap:
+                auto ticks =
+                    static_cast<double>((timestamps[1] - timestamps[0]) & timestampMask);
+                elapsed = static_cast<float>(ticks * limits.timestampPeriod * 1e-6);
+            }
+            else
+            {
+                using ms = std::chrono::duration<float, std::milli>;
+                elapsed = std::chrono::duration_cast<ms>(end - start).count();
+            }
+
+            time = std::min(time, elapsed / static_cast<float>(info.Iterations));
+        }
+
+        vkDestroyPipeline(ctx.Device, pipeline.Handle, nullptr);
+        vkDestroyPipelineLayout(ctx.Device, pipeline.Layout, nullptr);
+
+        result.Timings.push_back(WorkgroupTiming{size, time});
+
+        if (time < bestTime)
+        {
+            bestTime = time;
+            result.WorkgroupSize = size;
+        }
+    }
+
+    if (queryPool != VK_NULL_HANDLE)
+        vkDestroyQueryPool(ctx.Device, queryPool, nullptr);
+
+    WriteCache(device, info.Name, result.WorkgroupSize);
+
+    return result;
+}
\ No newline at end of file
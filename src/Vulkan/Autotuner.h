@@ -0,0 +1,53 @@
+#pragma once
+
+#include "Pipeline.h"
+#include "VulkanContext.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+struct WorkgroupTuningInfo {
+    // Key in the cache file (no whitespace), combined with device identity:
+    std::string Name;
+    std::vector<uint32_t> Candidates;
+
+    VkQueue Queue;
+    VkCommandPool Pool;
+
+    // Builds the kernel specialized for a given workgroup size:
+    std::function<Pipeline(uint32_t)> BuildPipeline;
+    // Records a single run of the kernel, including any barriers it needs:
+    std::function<void(VkCommandBuffer, const Pipeline &, uint32_t)> RecordDispatch;
+
+    uint32_t Iterations = 16;
+    bool IgnoreCache = false;
+    // Never measures, for callers that can't get the GPU to themselves yet:
+    bool CacheOnly = false;
+};
+
+struct WorkgroupTiming {
+    uint32_t WorkgroupSize;
+    float Milliseconds;
+};
+
+struct WorkgroupTuningResult {
+    uint32_t WorkgroupSize;
+    bool FromCache = false;
+    // Set if CacheOnly found no cached size, WorkgroupSize is then
+    // the first supported candidate and tuning still has to run:
+    bool Pending = false;
+    // Average time per run, empty if result came from cache:
+    std::vector<WorkgroupTiming> Timings;
+};
+
+namespace Autotuner
+{
+/**
+    Picks the fastest workgroup size out of the candidates supported by the device.
+    Each candidate is timed with timestamp queries (or wall clock if the device
+    lacks them), and the winner is cached on disk per vendor/device/driver.
+*/
+WorkgroupTuningResult FindWorkgroupSize(VulkanContext &ctx,
+                                        const WorkgroupTuningInfo &info);
+}; // namespace Autotuner
\ No newline at end of file
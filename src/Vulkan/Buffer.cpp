@@ -1,9 +1,23 @@
 #include "Buffer.h"
 
+#include "FrameStats.h"
 #include "Utils.h"
 
 Buffer Buffer::CreateBuffer(VulkanContext &ctx, VkDeviceSize size,
-                            VkBufferUsageFlags usage, VmaAllocationCreateFlags flags)
+                            VkBufferUsageFlags usage, VmaAllocationCreateFlags flags,
+                            VmaPool pool)
+{
+    VmaAllocationCreateInfo allocCreateInfo = {};
+    allocCreateInfo.usage = VMA_MEMORY_USAGE_AUTO;
+    allocCreateInfo.flags = flags;
+    allocCreateInfo.pool = pool;
+
+    return CreateBuffer(ctx, size, usage, allocCreateInfo);
+}
+
+Buffer Buffer::CreateBuffer(VulkanContext &ctx, VkDeviceSize size,
+                            VkBufferUsageFlags usage,
+                            const VmaAllocationCreateInfo &allocCreateInfo)
 {
     Buffer buf;
 
@@ -13,10 +27,6 @@ Buffer Buffer::CreateBuffer(VulkanContext &ctx, VkDeviceSize size,
     bufferInfo.usage = usage;
     bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-    VmaAllocationCreateInfo allocCreateInfo = {};
-    allocCreateInfo.usage = VMA_MEMORY_USAGE_AUTO;
-    allocCreateInfo.flags = flags;
-
     vmaCreateBuffer(ctx.Allocator, &bufferInfo, &allocCreateInfo, &buf.Handle,
                     &buf.Allocation, &buf.AllocInfo);
 
@@ -28,6 +38,33 @@ void Buffer::DestroyBuffer(VulkanContext &ctx, Buffer &buf)
     vmaDestroyBuffer(ctx.Allocator, buf.Handle, buf.Allocation);
 }
 
+VmaAllocationCreateFlags Buffer::DirectUploadFlags(VulkanContext &ctx)
+{
+    if (!ctx.DirectUploadSupported)
+        return 0;
+
+    return VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT |
+           VMA_ALLOCATION_CREATE_HOST_ACCESS_ALLOW_TRANSFER_INSTEAD_BIT |
+           VMA_ALLOCATION_CREATE_MAPPED_BIT;
+}
+
+bool Buffer::IsHostVisible(VulkanContext &ctx, const Buffer &buf)
+{
+    VkMemoryPropertyFlags properties;
+    vmaGetAllocationMemoryProperties(ctx.Allocator, buf.Allocation, &properties);
+
+    return properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+}
+
+VkDeviceAddress Buffer::GetDeviceAddress(VulkanContext &ctx, const Buffer &buf)
+{
+    VkBufferDeviceAddressInfo addressInfo{};
+    addressInfo.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+    addressInfo.buffer = buf.Handle;
+
+    return vkGetBufferDeviceAddress(ctx.Device, &addressInfo);
+}
+
 void Buffer::UploadToBuffer(VulkanContext &ctx, Buffer buff, const void *data,
                             VkDeviceSize size)
 {
@@ -39,6 +76,12 @@ void Buffer::UploadToMappedBuffer(Buffer buff, const void *data, VkDeviceSize si
     std::memcpy(buff.AllocInfo.pMappedData, data, size);
 }
 
+void Buffer::DownloadFromBuffer(VulkanContext &ctx, Buffer buff, void *data,
+                                VkDeviceSize size)
+{
+    vmaCopyAllocationToMemory(ctx.Allocator, buff.Allocation, 0, data, size);
+}
+
 Buffer Buffer::CreateStagingBuffer(VulkanContext &ctx, VkDeviceSize size)
 {
     auto usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
@@ -48,6 +91,15 @@ Buffer Buffer::CreateStagingBuffer(VulkanContext &ctx, VkDeviceSize size)
     return CreateBuffer(ctx, size, usage, flags);
 }
 
+Buffer Buffer::CreateReadbackBuffer(VulkanContext &ctx, VkDeviceSize size)
+{
+    auto usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    auto flags =
+        VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+    return CreateBuffer(ctx, size, usage, flags);
+}
+
 Buffer Buffer::CreateMappedUniformBuffer(VulkanContext &ctx, VkDeviceSize size)
 {
     auto usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
@@ -59,9 +111,28 @@ Buffer Buffer::CreateMappedUniformBuffer(VulkanContext &ctx, VkDeviceSize size)
 
 Buffer Buffer::CreateGPUBuffer(VulkanContext &ctx, GPUBufferInfo info)
 {
-    Buffer buff;
-    buff = CreateBuffer(ctx, info.Size, info.Usage, info.Properties);
+    ScopedFramePhase phase(FramePhase::Upload);
+
+    // Properties are required memory flags, not allocation flags:
+    VmaAllocationCreateInfo allocCreateInfo = {};
+    allocCreateInfo.usage = VMA_MEMORY_USAGE_AUTO;
+    allocCreateInfo.requiredFlags = info.Properties;
+    allocCreateInfo.flags = DirectUploadFlags(ctx);
+    allocCreateInfo.pool = info.MemoryPool;
 
+    Buffer buff = CreateBuffer(ctx, info.Size, info.Usage, allocCreateInfo);
+
+    // The buffer is not in use yet and the write becomes visible to the GPU
+    // with the next queue submission, so no synchronization is needed:
+    if (IsHostVisible(ctx, buff))
+    {
+        UploadToBuffer(ctx, buff, info.Data, info.Size);
+        ctx.Uploads.Direct.Record(info.Size);
+
+        return buff;
+    }
+
+    // Usage needs to include VK_BUFFER_USAGE_TRANSFER_DST_BIT for this path:
     Buffer stagingBuffer = Buffer::CreateStagingBuffer(ctx, info.Size);
     UploadToBuffer(ctx, stagingBuffer, info.Data, info.Size);
 
@@ -77,6 +148,8 @@ Buffer Buffer::CreateGPUBuffer(VulkanContext &ctx, GPUBufferInfo info)
 
     DestroyBuffer(ctx, stagingBuffer);
 
+    ctx.Uploads.Staged.Record(info.Size);
+
     return buff;
 }
 
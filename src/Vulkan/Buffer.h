@@ -17,32 +17,51 @@ struct GPUBufferInfo {
     VkDeviceSize Size;
     VkBufferUsageFlags Usage;
     VkMemoryPropertyFlags Properties;
+    // Custom pool to allocate from (e.g. MemoryPools::Geometry), default if null:
+    VmaPool MemoryPool = VK_NULL_HANDLE;
 };
 
 class Buffer {
   public:
     Buffer() = default;
 
+    // Lets VMA pick host visible device local memory if it is large enough
+    // (see VulkanContext::DirectUploadSupported), which is then written without
+    // a staging buffer. No flags otherwise, so allocations stay out of the BAR window:
+    static VmaAllocationCreateFlags DirectUploadFlags(VulkanContext &ctx);
+
     static uint32_t FindMemoryType(VulkanContext &ctx, uint32_t typeFilter,
                                    VkMemoryPropertyFlags properties);
 
     static Buffer CreateBuffer(VulkanContext &ctx, VkDeviceSize size,
-                               VkBufferUsageFlags usage, VmaAllocationCreateFlags flags);
+                               VkBufferUsageFlags usage, VmaAllocationCreateFlags flags,
+                               VmaPool pool = VK_NULL_HANDLE);
+    static Buffer CreateBuffer(VulkanContext &ctx, VkDeviceSize size,
+                               VkBufferUsageFlags usage,
+                               const VmaAllocationCreateInfo &allocCreateInfo);
     static void DestroyBuffer(VulkanContext &ctx, Buffer &buf);
 
+    static bool IsHostVisible(VulkanContext &ctx, const Buffer &buf);
+    // Requires VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT:
+    static VkDeviceAddress GetDeviceAddress(VulkanContext &ctx, const Buffer &buf);
+
     static void UploadToBuffer(VulkanContext &ctx, Buffer buff, const void *data,
                                VkDeviceSize size);
 
     static void UploadToMappedBuffer(Buffer buff, const void *data, VkDeviceSize size);
+    static void DownloadFromBuffer(VulkanContext &ctx, Buffer buff, void *data,
+                                   VkDeviceSize size);
 
     static Buffer CreateStagingBuffer(VulkanContext &ctx, VkDeviceSize size);
+    static Buffer CreateReadbackBuffer(VulkanContext &ctx, VkDeviceSize size);
     static Buffer CreateMappedUniformBuffer(VulkanContext &ctx, VkDeviceSize size);
+    // Writes the data directly if the memory ends up host visible, stages it otherwise:
     static Buffer CreateGPUBuffer(VulkanContext &ctx, GPUBufferInfo info);
 
     static void CopyBuffer(VulkanContext &ctx, CopyBufferInfo info);
 
   public:
-    VkBuffer Handle;
-    VmaAllocation Allocation;
-    VmaAllocationInfo AllocInfo;
+    VkBuffer Handle = VK_NULL_HANDLE;
+    VmaAllocation Allocation = VK_NULL_HANDLE;
+    VmaAllocationInfo AllocInfo{};
 };
\ No newline at end of file
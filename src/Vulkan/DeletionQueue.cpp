@@ -1,18 +1,200 @@
 #include "DeletionQueue.h"
 
+#include "VulkanContext.h"
+
+#include <algorithm>
+#include <array>
 #include <ranges>
+#include <stdexcept>
+#include <utility>
+
+// Order of destruction within a batch, users before the objects they refer to:
+static constexpr std::array<VkObjectType, 13> DestructionOrder{
+    VK_OBJECT_TYPE_PIPELINE,
+    VK_OBJECT_TYPE_PIPELINE_LAYOUT,
+    VK_OBJECT_TYPE_SHADER_MODULE,
+    VK_OBJECT_TYPE_DESCRIPTOR_POOL,
+    VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT,
+    VK_OBJECT_TYPE_SAMPLER,
+    VK_OBJECT_TYPE_IMAGE_VIEW,
+    VK_OBJECT_TYPE_IMAGE,
+    VK_OBJECT_TYPE_BUFFER,
+    VK_OBJECT_TYPE_COMMAND_POOL,
+    VK_OBJECT_TYPE_QUERY_POOL,
+    VK_OBJECT_TYPE_SEMAPHORE,
+    VK_OBJECT_TYPE_FENCE,
+};
+
+template <typename Handle>
+static Handle FromBits(uint64_t bits)
+{
+    if constexpr (std::is_pointer_v<Handle>)
+        return reinterpret_cast<Handle>(static_cast<uintptr_t>(bits));
+    else
+        return static_cast<Handle>(bits);
+}
 
 void DeletionQueue::push_back(std::function<void()> &&function)
 {
-    mDeletors.push_back(function);
+    mEntries.push_back(Entry{VK_OBJECT_TYPE_UNKNOWN, mClosures.size(), VK_NULL_HANDLE});
+    mClosures.push_back(std::move(function));
+}
+
+void DeletionQueue::PushObject(VkObjectType type, uint64_t handle,
+                               VmaAllocation allocation)
+{
+    if (std::ranges::find(DestructionOrder, type) == DestructionOrder.end())
+        throw std::logic_error("Unsupported object type in deletion queue!");
+
+    mEntries.push_back(Entry{type, handle, allocation});
 }
 
-void DeletionQueue::flush()
+void DeletionQueue::append(DeletionQueue &&other)
 {
-    for (auto &deletor : mDeletors | std::views::reverse)
+    for (auto &entry : other.mEntries)
     {
-        deletor();
+        if (entry.Type == VK_OBJECT_TYPE_UNKNOWN)
+            push_back(std::move(other.mClosures[entry.Handle]));
+        else
+            mEntries.push_back(entry);
     }
 
-    mDeletors.clear();
+    other.mEntries.clear();
+    other.mClosures.clear();
+}
+
+void DeletionQueue::flush(VulkanContext &ctx)
+{
+    // Walks backwards, destroying runs of objects between closures at once:
+    size_t end = mEntries.size();
+
+    while (end > 0)
+    {
+        auto &last = mEntries[end - 1];
+
+        if (last.Type == VK_OBJECT_TYPE_UNKNOWN)
+        {
+            mClosures[last.Handle]();
+            end--;
+            continue;
+        }
+
+        size_t begin = end - 1;
+
+        while (begin > 0 && mEntries[begin - 1].Type != VK_OBJECT_TYPE_UNKNOWN)
+            begin--;
+
+        DestroyBatch(ctx, mEntries.data() + begin, mEntries.data() + end);
+        end = begin;
+    }
+
+    // Keeps the capacity, for queues that are refilled:
+    mEntries.clear();
+    mClosures.clear();
+}
+
+void DeletionQueue::DestroyBatch(VulkanContext &ctx, const Entry *begin,
+                                 const Entry *end)
+{
+    VkDevice device = ctx.Device;
+
+    // One pass per type, each newest first:
+    auto objects = [=](VkObjectType type) {
+        return std::ranges::subrange(begin, end) | std::views::reverse |
+               std::views::filter([type](const Entry &e) { return e.Type == type; });
+    };
+
+    for (auto &e : objects(VK_OBJECT_TYPE_PIPELINE))
+        vkDestroyPipeline(device, FromBits<VkPipeline>(e.Handle), nullptr);
+
+    for (auto &e : objects(VK_OBJECT_TYPE_PIPELINE_LAYOUT))
+        vkDestroyPipelineLayout(device, FromBits<VkPipelineLayout>(e.Handle), nullptr);
+
+    for (auto &e : objects(VK_OBJECT_TYPE_SHADER_MODULE))
+        vkDestroyShaderModule(device, FromBits<VkShaderModule>(e.Handle), nullptr);
+
+    for (auto &e : objects(VK_OBJECT_TYPE_DESCRIPTOR_POOL))
+        vkDestroyDescriptorPool(device, FromBits<VkDescriptorPool>(e.Handle), nullptr);
+
+    for (auto &e : objects(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT))
+    {
+        vkDestroyDescriptorSetLayout(device, FromBits<VkDescriptorSetLayout>(e.Handle),
+                                     nullptr);
+    }
+
+    for (auto &e : objects(VK_OBJECT_TYPE_SAMPLER))
+        vkDestroySampler(device, FromBits<VkSampler>(e.Handle), nullptr);
+
+    for (auto &e : objects(VK_OBJECT_TYPE_IMAGE_VIEW))
+        vkDestroyImageView(device, FromBits<VkImageView>(e.Handle), nullptr);
+
+    for (auto &e : objects(VK_OBJECT_TYPE_IMAGE))
+        vmaDestroyImage(ctx.Allocator, FromBits<VkImage>(e.Handle), e.Allocation);
+
+    for (auto &e : objects(VK_OBJECT_TYPE_BUFFER))
+        vmaDestroyBuffer(ctx.Allocator, FromBits<VkBuffer>(e.Handle), e.Allocation);
+
+    for (auto &e : objects(VK_OBJECT_TYPE_COMMAND_POOL))
+        vkDestroyCommandPool(device, FromBits<VkCommandPool>(e.Handle), nullptr);
+
+    for (auto &e : objects(VK_OBJECT_TYPE_QUERY_POOL))
+        vkDestroyQueryPool(device, FromBits<VkQueryPool>(e.Handle), nullptr);
+
+    for (auto &e : objects(VK_OBJECT_TYPE_SEMAPHORE))
+        vkDestroySemaphore(device, FromBits<VkSemaphore>(e.Handle), nullptr);
+
+    for (auto &e : objects(VK_OBJECT_TYPE_FENCE))
+        vkDestroyFence(device, FromBits<VkFence>(e.Handle), nullptr);
+}
+
+DeletionQueue &DeferredDeletionQueue::BatchFor(uint64_t timelineValue)
+{
+    if (!mBatches.empty() && mBatches.back().TimelineValue == timelineValue)
+        return mBatches.back().Queue;
+
+    DeletionQueue queue;
+
+    if (!mFreeQueues.empty())
+    {
+        queue = std::move(mFreeQueues.back());
+        mFreeQueues.pop_back();
+    }
+
+    mBatches.push_back(Batch{timelineValue, std::move(queue)});
+
+    return mBatches.back().Queue;
+}
+
+void DeferredDeletionQueue::push_back(uint64_t timelineValue,
+                                      std::function<void()> &&function)
+{
+    BatchFor(timelineValue).push_back(std::move(function));
+}
+
+void DeferredDeletionQueue::push_back(uint64_t timelineValue, DeletionQueue &&queue)
+{
+    BatchFor(timelineValue).append(std::move(queue));
+}
+
+void DeferredDeletionQueue::collect(VulkanContext &ctx, uint64_t completedValue)
+{
+    auto ready = [completedValue](const Batch &batch) {
+        return batch.TimelineValue <= completedValue;
+    };
+
+    for (auto &batch : mBatches | std::views::reverse)
+    {
+        if (!ready(batch))
+            continue;
+
+        batch.Queue.flush(ctx);
+        mFreeQueues.push_back(std::move(batch.Queue));
+    }
+
+    std::erase_if(mBatches, ready);
+}
+
+void DeferredDeletionQueue::flush(VulkanContext &ctx)
+{
+    collect(ctx, UINT64_MAX);
 }
\ No newline at end of file
@@ -1,15 +1,111 @@
 #pragma once
 
-#include <deque>
+#include "vk_mem_alloc.h"
+
+#include <cstdint>
 #include <functional>
+#include <type_traits>
+#include <vector>
+
+class VulkanContext;
 
+/**
+    Objects to destroy in reverse order of pushing. Vulkan handles are stored
+    inline as {type, handle, allocation} entries and consecutive ones are destroyed
+    in batched loops per type, so pushing them never allocates beyond
+    growing the vector. Closures remain as a fallback for objects needing
+    more than a single destroy call, or handles that get replaced later on
+    (closures capturing members by reference destroy whatever is current).
+*/
 class DeletionQueue {
   public:
     DeletionQueue() = default;
 
     void push_back(std::function<void()> &&function);
-    void flush();
+
+    // Images and buffers created with VMA also take their allocation:
+    template <typename Handle>
+    void push_back(VkObjectType type, Handle handle,
+                   VmaAllocation allocation = VK_NULL_HANDLE)
+    {
+        PushObject(type, ToBits(handle), allocation);
+    }
+
+    // Moves all entries of other to the back of this queue:
+    void append(DeletionQueue &&other);
+
+    void flush(VulkanContext &ctx);
+
+    [[nodiscard]] bool empty() const
+    {
+        return mEntries.empty();
+    }
+
+  private:
+    struct Entry {
+        // VK_OBJECT_TYPE_UNKNOWN marks closures, with Handle indexing mClosures:
+        VkObjectType Type;
+        uint64_t Handle;
+        VmaAllocation Allocation;
+    };
+
+    // Non-dispatchable handles are pointers on 64-bit platforms and
+    // integers elsewhere:
+    template <typename Handle>
+    static uint64_t ToBits(Handle handle)
+    {
+        if constexpr (std::is_pointer_v<Handle>)
+            return reinterpret_cast<uintptr_t>(handle);
+        else
+            return static_cast<uint64_t>(handle);
+    }
+
+    void PushObject(VkObjectType type, uint64_t handle, VmaAllocation allocation);
+    static void DestroyBatch(VulkanContext &ctx, const Entry *begin, const Entry *end);
+
+  private:
+    std::vector<Entry> mEntries;
+    std::vector<std::function<void()>> mClosures;
+};
+
+/// Deletion queues tagged with the graphics timeline value of the last submission
+/// using their objects. They are flushed once the GPU has reached that value, so
+/// objects can be replaced mid-run without waiting for the device.
+class DeferredDeletionQueue {
+  public:
+    DeferredDeletionQueue() = default;
+
+    void push_back(uint64_t timelineValue, std::function<void()> &&function);
+
+    template <typename Handle>
+    void push_back(uint64_t timelineValue, VkObjectType type, Handle handle,
+                   VmaAllocation allocation = VK_NULL_HANDLE)
+    {
+        BatchFor(timelineValue).push_back(type, handle, allocation);
+    }
+
+    void push_back(uint64_t timelineValue, DeletionQueue &&queue);
+
+    // Flushes queues with values up to completedValue, newest first:
+    void collect(VulkanContext &ctx, uint64_t completedValue);
+    void flush(VulkanContext &ctx);
+
+    [[nodiscard]] bool empty() const
+    {
+        return mBatches.empty();
+    }
 
   private:
-    std::deque<std::function<void()>> mDeletors;
+    DeletionQueue &BatchFor(uint64_t timelineValue);
+
+  private:
+    struct Batch {
+        uint64_t TimelineValue;
+        DeletionQueue Queue;
+    };
+
+    // Pushes with the same value as the newest batch share it:
+    std::vector<Batch> mBatches;
+    // Flushed queues keep their capacity, to be reused by new batches:
+    std::vector<DeletionQueue> mFreeQueues;
 };
\ No newline at end of file
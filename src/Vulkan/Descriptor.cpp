@@ -1,5 +1,9 @@
 #include "Descriptor.h"
 
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
 DescriptorSetLayoutBuilder DescriptorSetLayoutBuilder::AddBinding(uint32_t binding,
                                                                   VkDescriptorType type,
                                                                   uint32_t stages)
@@ -19,20 +23,231 @@ DescriptorSetLayoutBuilder DescriptorSetLayoutBuilder::AddBinding(uint32_t bindi
 
 VkDescriptorSetLayout DescriptorSetLayoutBuilder::Build(VulkanContext &ctx)
 {
+    return ctx.DescriptorLayouts->Get(mBindings);
+}
+
+DescriptorLayoutCache::DescriptorLayoutCache(VulkanContext &ctx) : ctx(ctx)
+{
+}
+
+DescriptorLayoutCache::~DescriptorLayoutCache()
+{
+    for (auto &[key, layout] : mLayouts)
+        vkDestroyDescriptorSetLayout(ctx.Device, layout, nullptr);
+}
+
+VkDescriptorSetLayout DescriptorLayoutCache::Get(
+    std::span<const VkDescriptorSetLayoutBinding> bindings)
+{
+    LayoutKey key{.Bindings = {bindings.begin(), bindings.end()}};
+
+    std::sort(key.Bindings.begin(), key.Bindings.end(),
+              [](const auto &a, const auto &b) { return a.binding < b.binding; });
+
+    std::lock_guard lock(mMutex);
+
+    if (auto it = mLayouts.find(key); it != mLayouts.end())
+        return it->second;
+
     VkDescriptorSetLayout layout;
 
     VkDescriptorSetLayoutCreateInfo layoutInfo{};
     layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    layoutInfo.bindingCount = static_cast<uint32_t>(mBindings.size());
-    layoutInfo.pBindings = mBindings.data();
+    layoutInfo.bindingCount = static_cast<uint32_t>(key.Bindings.size());
+    layoutInfo.pBindings = key.Bindings.data();
 
     if (vkCreateDescriptorSetLayout(ctx.Device, &layoutInfo, nullptr, &layout) !=
         VK_SUCCESS)
         throw std::runtime_error("Failed to create descriptor set layout!");
 
+    std::vector<PoolCount> counts;
+
+    for (const auto &b : key.Bindings)
+    {
+        auto it = std::find_if(counts.begin(), counts.end(), [&](const PoolCount &count) {
+            return count.Type == b.descriptorType;
+        });
+
+        if (it != counts.end())
+            it->Count += b.descriptorCount;
+        else
+            counts.push_back({b.descriptorType, b.descriptorCount});
+    }
+
+    mDescriptorCounts.emplace(layout, std::move(counts));
+    mLayouts.emplace(std::move(key), layout);
+
     return layout;
 }
 
+std::vector<PoolCount> DescriptorLayoutCache::GetDescriptorCounts(
+    VkDescriptorSetLayout layout)
+{
+    std::lock_guard lock(mMutex);
+
+    if (auto it = mDescriptorCounts.find(layout); it != mDescriptorCounts.end())
+        return it->second;
+
+    return {};
+}
+
+bool DescriptorLayoutCache::LayoutKey::operator==(const LayoutKey &other) const
+{
+    auto equal = [](const VkDescriptorSetLayoutBinding &a,
+                    const VkDescriptorSetLayoutBinding &b) {
+        return a.binding == b.binding && a.descriptorType == b.descriptorType &&
+               a.descriptorCount == b.descriptorCount && a.stageFlags == b.stageFlags &&
+               a.pImmutableSamplers == b.pImmutableSamplers;
+    };
+
+    return std::equal(Bindings.begin(), Bindings.end(), other.Bindings.begin(),
+                      other.Bindings.end(), equal);
+}
+
+size_t DescriptorLayoutCache::LayoutKeyHash::operator()(const LayoutKey &key) const
+{
+    size_t hash = key.Bindings.size();
+
+    // Same mixing as boost::hash_combine:
+    auto combine = [&](size_t value) {
+        hash ^= value + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    };
+
+    for (const auto &b : key.Bindings)
+    {
+        combine(b.binding);
+        combine(static_cast<size_t>(b.descriptorType));
+        combine(b.descriptorCount);
+        combine(b.stageFlags);
+        combine(std::hash<const void *>{}(b.pImmutableSamplers));
+    }
+
+    return hash;
+}
+
+void DescriptorAllocator::Init(uint32_t initialSets, std::span<const PoolRatio> ratios)
+{
+    mRatios.assign(ratios.begin(), ratios.end());
+    mSetsPerPool = initialSets;
+}
+
+void DescriptorAllocator::Destroy(VulkanContext &ctx)
+{
+    // Frees the sets as well:
+    for (auto pool : mReadyPools)
+        vkDestroyDescriptorPool(ctx.Device, pool, nullptr);
+
+    for (auto pool : mFullPools)
+        vkDestroyDescriptorPool(ctx.Device, pool, nullptr);
+
+    mReadyPools.clear();
+    mFullPools.clear();
+}
+
+void DescriptorAllocator::Reset(VulkanContext &ctx)
+{
+    for (auto pool : mReadyPools)
+        vkResetDescriptorPool(ctx.Device, pool, 0);
+
+    for (auto pool : mFullPools)
+    {
+        vkResetDescriptorPool(ctx.Device, pool, 0);
+        mReadyPools.push_back(pool);
+    }
+
+    mFullPools.clear();
+}
+
+VkDescriptorSet DescriptorAllocator::Allocate(VulkanContext &ctx,
+                                              VkDescriptorSetLayout layout)
+{
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &layout;
+
+    VkDescriptorSet set;
+    VkResult result;
+
+    while (true)
+    {
+        // A new pool always fits the layout, so it is the last attempt:
+        bool newPool = mReadyPools.empty();
+
+        allocInfo.descriptorPool = GetPool(ctx, layout);
+        result = vkAllocateDescriptorSets(ctx.Device, &allocInfo, &set);
+
+        bool exhausted =
+            result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL;
+
+        if (!exhausted || newPool)
+            break;
+
+        // Exhausted pool is retired until the next Reset:
+        mFullPools.push_back(mReadyPools.back());
+        mReadyPools.pop_back();
+    }
+
+    if (result != VK_SUCCESS)
+        throw std::runtime_error("Failed to allocate descriptor sets!");
+
+    return set;
+}
+
+std::vector<VkDescriptorSet> DescriptorAllocator::Allocate(
+    VulkanContext &ctx, std::span<VkDescriptorSetLayout> layouts)
+{
+    std::vector<VkDescriptorSet> descriptorSets;
+    descriptorSets.reserve(layouts.size());
+
+    for (auto layout : layouts)
+        descriptorSets.push_back(Allocate(ctx, layout));
+
+    return descriptorSets;
+}
+
+VkDescriptorPool DescriptorAllocator::GetPool(VulkanContext &ctx,
+                                              VkDescriptorSetLayout layout)
+{
+    if (!mReadyPools.empty())
+        return mReadyPools.back();
+
+    VkDescriptorPool pool = CreatePool(ctx, mSetsPerPool, layout);
+    mReadyPools.push_back(pool);
+
+    // Each pool is bigger than the previous one, so few are needed overall:
+    mSetsPerPool = std::min(mSetsPerPool + mSetsPerPool / 2, MAX_SETS_PER_POOL);
+
+    return pool;
+}
+
+VkDescriptorPool DescriptorAllocator::CreatePool(VulkanContext &ctx, uint32_t setCount,
+                                                 VkDescriptorSetLayout layout)
+{
+    std::vector<PoolCount> poolCounts;
+
+    for (auto &ratio : mRatios)
+    {
+        auto count = static_cast<uint32_t>(ratio.Ratio * static_cast<float>(setCount));
+        poolCounts.push_back({ratio.Type, std::max(count, 1u)});
+    }
+
+    // Ratios may not cover the layout (e.g. a single set with many storage buffers):
+    for (auto required : ctx.DescriptorLayouts->GetDescriptorCounts(layout))
+    {
+        auto it = std::find_if(
+            poolCounts.begin(), poolCounts.end(),
+            [&](const PoolCount &count) { return count.Type == required.Type; });
+
+        if (it != poolCounts.end())
+            it->Count = std::max(it->Count, required.Count);
+        else
+            poolCounts.push_back(required);
+    }
+
+    return Descriptor::InitPool(ctx, setCount, poolCounts);
+}
+
 VkDescriptorPool Descriptor::InitPool(VulkanContext &ctx, uint32_t maxSets,
                                       std::span<PoolCount> poolCounts)
 {
@@ -59,22 +274,4 @@ VkDescriptorPool Descriptor::InitPool(VulkanContext &ctx, uint32_t maxSets,
         throw std::runtime_error("Failed to create descriptor pool!");
 
     return pool;
-}
-
-std::vector<VkDescriptorSet> Descriptor::Allocate(
-    VulkanContext &ctx, VkDescriptorPool pool, std::span<VkDescriptorSetLayout> layouts)
-{
-    std::vector<VkDescriptorSet> descriptorSets(layouts.size());
-
-    VkDescriptorSetAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocInfo.descriptorPool = pool;
-    allocInfo.descriptorSetCount = static_cast<uint32_t>(layouts.size());
-    allocInfo.pSetLayouts = layouts.data();
-
-    if (vkAllocateDescriptorSets(ctx.Device, &allocInfo, descriptorSets.data()) !=
-        VK_SUCCESS)
-        throw std::runtime_error("Failed to allocate descriptor sets!");
-
-    return descriptorSets;
 }
\ No newline at end of file
@@ -2,7 +2,11 @@
 
 #include "VulkanContext.h"
 
+#include <array>
+#include <mutex>
 #include <span>
+#include <unordered_map>
+#include <vector>
 
 class DescriptorSetLayoutBuilder {
   public:
@@ -11,6 +15,7 @@ class DescriptorSetLayoutBuilder {
     DescriptorSetLayoutBuilder AddBinding(uint32_t binding, VkDescriptorType type,
                                           uint32_t stages);
 
+    // Returned layout is shared through ctx.DescriptorLayouts and must not be destroyed:
     VkDescriptorSetLayout Build(VulkanContext &ctx);
 
   private:
@@ -22,11 +27,100 @@ struct PoolCount {
     uint32_t Count;
 };
 
+/**
+    Owner of all descriptor set layouts, so identical layouts requested by
+    different renderers (or recreated renderers) map to a single handle.
+    Layouts live as long as the cache, which outlives all renderers.
+    Thread safe, since renderers get constructed on a background thread.
+*/
+class DescriptorLayoutCache {
+  public:
+    explicit DescriptorLayoutCache(VulkanContext &ctx);
+    ~DescriptorLayoutCache();
+
+    DescriptorLayoutCache(const DescriptorLayoutCache &) = delete;
+    DescriptorLayoutCache &operator=(const DescriptorLayoutCache &) = delete;
+
+    // Order of the bindings doesn't matter:
+    VkDescriptorSetLayout Get(std::span<const VkDescriptorSetLayoutBinding> bindings);
+
+    // Descriptors of each type in a single set, empty for layouts not created here:
+    std::vector<PoolCount> GetDescriptorCounts(VkDescriptorSetLayout layout);
+
+  private:
+    struct LayoutKey {
+        // Sorted by binding index:
+        std::vector<VkDescriptorSetLayoutBinding> Bindings;
+
+        bool operator==(const LayoutKey &other) const;
+    };
+
+    struct LayoutKeyHash {
+        size_t operator()(const LayoutKey &key) const;
+    };
+
+    VulkanContext &ctx;
+
+    std::mutex mMutex;
+    std::unordered_map<LayoutKey, VkDescriptorSetLayout, LayoutKeyHash> mLayouts;
+    std::unordered_map<VkDescriptorSetLayout, std::vector<PoolCount>> mDescriptorCounts;
+};
+
+// Descriptors of a type per set, pools are sized by multiplying it with the set count:
+struct PoolRatio {
+    VkDescriptorType Type;
+    float Ratio;
+};
+
+/**
+    Growable descriptor set allocator. Sets come from a list of pools, when
+    one runs out (VK_ERROR_OUT_OF_POOL_MEMORY or VK_ERROR_FRAGMENTED_POOL)
+    a bigger one is created, so descriptors never need to be counted up
+    front. Pools are created on demand and always fit at least one set of the
+    layout being allocated. Sets are not freed individually, Reset recycles
+    all of them at once. Not thread safe, each renderer and frame context has its own.
+*/
+class DescriptorAllocator {
+  public:
+    static constexpr std::array<PoolRatio, 5> DEFAULT_RATIOS{{
+        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.0f},
+        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1.0f},
+        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4.0f},
+        {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.0f},
+        {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1.0f},
+    }};
+
+    DescriptorAllocator() = default;
+
+    void Init(uint32_t initialSets = 16,
+              std::span<const PoolRatio> ratios = DEFAULT_RATIOS);
+    void Destroy(VulkanContext &ctx);
+
+    // All sets allocated so far must no longer be in use by the GPU:
+    void Reset(VulkanContext &ctx);
+
+    VkDescriptorSet Allocate(VulkanContext &ctx, VkDescriptorSetLayout layout);
+    std::vector<VkDescriptorSet> Allocate(VulkanContext &ctx,
+                                          std::span<VkDescriptorSetLayout> layouts);
+
+  private:
+    VkDescriptorPool GetPool(VulkanContext &ctx, VkDescriptorSetLayout layout);
+    VkDescriptorPool CreatePool(VulkanContext &ctx, uint32_t setCount,
+                                VkDescriptorSetLayout layout);
+
+  private:
+    static constexpr uint32_t MAX_SETS_PER_POOL = 4096;
+
+    std::vector<PoolRatio> mRatios;
+    uint32_t mSetsPerPool = 0;
+
+    // Last ready pool is the one currently allocated from:
+    std::vector<VkDescriptorPool> mReadyPools;
+    std::vector<VkDescriptorPool> mFullPools;
+};
+
 namespace Descriptor
 {
 VkDescriptorPool InitPool(VulkanContext &ctx, uint32_t maxSets,
                           std::span<PoolCount> poolCounts);
-
-std::vector<VkDescriptorSet> Allocate(VulkanContext &ctx, VkDescriptorPool pool,
-                                      std::span<VkDescriptorSetLayout> layouts);
 }; // namespace Descriptor
\ No newline at end of file
@@ -0,0 +1,123 @@
+#include "FrameContext.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+void FrameContext::Init(VulkanContext &ctx, VkDeviceSize uploadCapacity)
+{
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex =
+        ctx.Device.get_queue_index(vkb::QueueType::graphics).value();
+
+    if (vkCreateCommandPool(ctx.Device, &poolInfo, nullptr, &mCommandPool) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create a command pool!");
+
+    // Only a few renderers upload per frame, the arena is created on demand:
+    mInitialUploadCapacity = uploadCapacity;
+
+    // No pool is created until the first set is allocated, most frames never do:
+    Descriptors.Init();
+}
+
+void FrameContext::Destroy(VulkanContext &ctx)
+{
+    Deletions.flush(ctx);
+
+    Descriptors.Destroy(ctx);
+
+    ReleaseUploads(ctx);
+
+    // Frees the command buffers as well:
+    vkDestroyCommandPool(ctx.Device, mCommandPool, nullptr);
+}
+
+void FrameContext::Reset(VulkanContext &ctx)
+{
+    Deletions.flush(ctx);
+
+    // One call instead of resetting each buffer:
+    vkResetCommandPool(ctx.Device, mCommandPool, 0);
+    mUsedCommandBuffers = 0;
+
+    Descriptors.Reset(ctx);
+
+    mUploadOffset = 0;
+}
+
+VkCommandBuffer FrameContext::AllocateCommandBuffer(VulkanContext &ctx)
+{
+    if (mUsedCommandBuffers == mCommandBuffers.size())
+    {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = mCommandPool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+
+        VkCommandBuffer buffer;
+
+        if (vkAllocateCommandBuffers(ctx.Device, &allocInfo, &buffer) != VK_SUCCESS)
+            throw std::runtime_error("Failed to allocate command buffers!");
+
+        mCommandBuffers.push_back(buffer);
+    }
+
+    return mCommandBuffers[mUsedCommandBuffers++];
+}
+
+FrameContext::UploadAllocation FrameContext::AllocateUpload(VulkanContext &ctx,
+                                                            VkDeviceSize size,
+                                                            VkDeviceSize alignment)
+{
+    VkDeviceSize offset = (mUploadOffset + alignment - 1) / alignment * alignment;
+
+    if (mUploadCapacity == 0)
+    {
+        mUploadCapacity = std::max(mInitialUploadCapacity, size);
+        mUploadBuffer = Buffer::CreateStagingBuffer(ctx, mUploadCapacity);
+
+        offset = 0;
+    }
+    else if (offset + size > mUploadCapacity)
+    {
+        // Earlier allocations of this frame may still be read by its commands:
+        FlushUploads(ctx);
+
+        Deletions.push_back(VK_OBJECT_TYPE_BUFFER, mUploadBuffer.Handle,
+                            mUploadBuffer.Allocation);
+
+        mUploadCapacity = std::max(2 * mUploadCapacity, size);
+        mUploadBuffer = Buffer::CreateStagingBuffer(ctx, mUploadCapacity);
+
+        offset = 0;
+    }
+
+    mUploadOffset = offset + size;
+
+    auto data = static_cast<std::byte *>(mUploadBuffer.AllocInfo.pMappedData);
+
+    return UploadAllocation{
+        .Buffer = mUploadBuffer.Handle,
+        .Offset = offset,
+        .Data = data + offset,
+    };
+}
+
+void FrameContext::FlushUploads(VulkanContext &ctx)
+{
+    if (mUploadOffset > 0)
+        vmaFlushAllocation(ctx.Allocator, mUploadBuffer.Allocation, 0, mUploadOffset);
+}
+
+void FrameContext::ReleaseUploads(VulkanContext &ctx)
+{
+    if (mUploadCapacity == 0)
+        return;
+
+    Buffer::DestroyBuffer(ctx, mUploadBuffer);
+
+    mUploadCapacity = 0;
+    mUploadOffset = 0;
+}
\ No newline at end of file
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Buffer.h"
+#include "DeletionQueue.h"
+#include "Descriptor.h"
+#include "VulkanContext.h"
+
+#include <cstddef>
+#include <vector>
+
+/**
+    Resources owned by a single frame in flight: a transient command pool,
+    a linear upload arena, a descriptor allocator and a deletion list.
+    Everything is recycled at once
+    in Reset, which must be called after the GPU has finished the previous
+    use of the frame.
+*/
+class FrameContext {
+  public:
+    struct UploadAllocation {
+        VkBuffer Buffer;
+        VkDeviceSize Offset;
+        std::byte *Data;
+    };
+
+    void Init(VulkanContext &ctx, VkDeviceSize uploadCapacity = DEFAULT_UPLOAD_CAPACITY);
+    void Destroy(VulkanContext &ctx);
+
+    void Reset(VulkanContext &ctx);
+
+    // Primary buffer from the transient pool, valid until the next Reset:
+    VkCommandBuffer AllocateCommandBuffer(VulkanContext &ctx);
+
+    // Host visible memory usable as a transfer source until the next Reset.
+    // The arena is created on first use. If it is full it grows, keeping
+    // the previous buffer alive until then:
+    UploadAllocation AllocateUpload(VulkanContext &ctx, VkDeviceSize size,
+                                    VkDeviceSize alignment = 16);
+    // Makes writes to the arena visible, before submitting commands reading them:
+    void FlushUploads(VulkanContext &ctx);
+    // Frees the arena until the next AllocateUpload, the GPU must be done with the frame:
+    void ReleaseUploads(VulkanContext &ctx);
+
+  public:
+    // Flushed on the next Reset, for objects used by this frame's commands:
+    DeletionQueue Deletions;
+    // Transient descriptor sets, valid until the next Reset:
+    DescriptorAllocator Descriptors;
+
+  private:
+    static constexpr VkDeviceSize DEFAULT_UPLOAD_CAPACITY = 1 << 20;
+
+    VkCommandPool mCommandPool = VK_NULL_HANDLE;
+    // Kept across resets, since resetting the pool recycles them as well:
+    std::vector<VkCommandBuffer> mCommandBuffers;
+    size_t mUsedCommandBuffers = 0;
+
+    // Size of the arena created by the first AllocateUpload:
+    VkDeviceSize mInitialUploadCapacity = DEFAULT_UPLOAD_CAPACITY;
+
+    Buffer mUploadBuffer;
+    // Zero while there is no arena:
+    VkDeviceSize mUploadCapacity = 0;
+    VkDeviceSize mUploadOffset = 0;
+};
\ No newline at end of file
@@ -0,0 +1,180 @@
+#include "GeometryArena.h"
+
+#include "FrameStats.h"
+#include "Utils.h"
+
+#include <stdexcept>
+
+static VmaVirtualBlock CreateVirtualBlock(VkDeviceSize size)
+{
+    VmaVirtualBlockCreateInfo blockInfo{};
+    blockInfo.size = size;
+
+    VmaVirtualBlock block;
+
+    if (vmaCreateVirtualBlock(&blockInfo, &block) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create a virtual block!");
+
+    return block;
+}
+
+GeometryArena::GeometryArena(VulkanContext &ctx, VkDeviceSize vertexCapacity,
+                             VkDeviceSize indexCapacity)
+    : ctx(ctx)
+{
+    VmaAllocationCreateInfo allocCreateInfo{};
+    allocCreateInfo.usage = VMA_MEMORY_USAGE_AUTO;
+    allocCreateInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    allocCreateInfo.flags = Buffer::DirectUploadFlags(ctx);
+
+    // Storage and device address usage for vertex pulling and compute passes:
+    constexpr VkBufferUsageFlags commonUsage = VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                                               VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                                               VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+
+    mVertexBuffer = Buffer::CreateBuffer(
+        ctx, vertexCapacity, commonUsage | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+        allocCreateInfo);
+
+    mIndexBuffer = Buffer::CreateBuffer(
+        ctx, indexCapacity, commonUsage | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+        allocCreateInfo);
+
+    mVertexAddress = Buffer::GetDeviceAddress(ctx, mVertexBuffer);
+    mIndexAddress = Buffer::GetDeviceAddress(ctx, mIndexBuffer);
+
+    mVertexBlock = CreateVirtualBlock(vertexCapacity);
+    mIndexBlock = CreateVirtualBlock(indexCapacity);
+
+    mHostVisible = Buffer::IsHostVisible(ctx, mVertexBuffer) &&
+                   Buffer::IsHostVisible(ctx, mIndexBuffer);
+}
+
+GeometryArena::~GeometryArena()
+{
+    vmaDestroyVirtualBlock(mVertexBlock);
+    vmaDestroyVirtualBlock(mIndexBlock);
+
+    Buffer::DestroyBuffer(ctx, mVertexBuffer);
+    Buffer::DestroyBuffer(ctx, mIndexBuffer);
+}
+
+GeometryArena::Mesh GeometryArena::Upload(const UploadInfo &info)
+{
+    ScopedFramePhase phase(FramePhase::Upload);
+
+    const VkDeviceSize stride = info.VertexStride;
+    const VkDeviceSize vertexBytes = info.VertexCount * stride;
+    const VkDeviceSize indexBytes = info.Indices.size_bytes();
+
+    Mesh mesh;
+    VkDeviceSize vertexRange, indexRange;
+
+    {
+        std::lock_guard lock(mMutex);
+
+        // Strides need not be powers of two, so instead of aligning, the range
+        // is padded to always contain a start that is a multiple of the stride:
+        VmaVirtualAllocationCreateInfo vertexInfo{};
+        vertexInfo.size = vertexBytes + stride - 1;
+
+        if (vmaVirtualAllocate(mVertexBlock, &vertexInfo, &mesh.VertexAllocation,
+                               &vertexRange) != VK_SUCCESS)
+            throw std::runtime_error("Geometry arena is out of vertex memory!");
+
+        VmaVirtualAllocationCreateInfo indexInfo{};
+        indexInfo.size = indexBytes;
+        indexInfo.alignment = sizeof(uint32_t);
+
+        if (vmaVirtualAllocate(mIndexBlock, &indexInfo, &mesh.IndexAllocation,
+                               &indexRange) != VK_SUCCESS)
+        {
+            vmaVirtualFree(mVertexBlock, mesh.VertexAllocation);
+            throw std::runtime_error("Geometry arena is out of index memory!");
+        }
+    }
+
+    const VkDeviceSize firstVertex = (vertexRange + stride - 1) / stride;
+
+    mesh.VertexOffset = static_cast<int32_t>(firstVertex);
+    mesh.FirstIndex = static_cast<uint32_t>(indexRange / sizeof(uint32_t));
+    mesh.IndexCount = static_cast<uint32_t>(info.Indices.size());
+
+    const VkDeviceSize vertexDst = firstVertex * stride;
+
+    // Freshly allocated ranges are not read by any submitted work, so they
+    // can be written in place:
+    if (mHostVisible)
+    {
+        vmaCopyMemoryToAllocation(ctx.Allocator, info.Vertices, mVertexBuffer.Allocation,
+                                  vertexDst, vertexBytes);
+        vmaCopyMemoryToAllocation(ctx.Allocator, info.Indices.data(),
+                                  mIndexBuffer.Allocation, indexRange, indexBytes);
+
+        ctx.Uploads.Direct.Record(vertexBytes + indexBytes);
+
+        return mesh;
+    }
+
+    // Both ranges go through a single staging buffer and submission:
+    Buffer staging = Buffer::CreateStagingBuffer(ctx, vertexBytes + indexBytes);
+
+    vmaCopyMemoryToAllocation(ctx.Allocator, info.Vertices, staging.Allocation, 0,
+                              vertexBytes);
+    vmaCopyMemoryToAllocation(ctx.Allocator, info.Indices.data(), staging.Allocation,
+                              vertexBytes, indexBytes);
+
+    {
+        utils::ScopedCommand cmd(ctx, info.Queue, info.Pool);
+
+        VkBufferCopy vertexCopy{
+            .srcOffset = 0,
+            .dstOffset = vertexDst,
+            .size = vertexBytes,
+        };
+
+        VkBufferCopy indexCopy{
+            .srcOffset = vertexBytes,
+            .dstOffset = indexRange,
+            .size = indexBytes,
+        };
+
+        vkCmdCopyBuffer(cmd.Buffer, staging.Handle, mVertexBuffer.Handle, 1, &vertexCopy);
+        vkCmdCopyBuffer(cmd.Buffer, staging.Handle, mIndexBuffer.Handle, 1, &indexCopy);
+    }
+
+    Buffer::DestroyBuffer(ctx, staging);
+
+    ctx.Uploads.Staged.Record(vertexBytes + indexBytes);
+
+    return mesh;
+}
+
+void GeometryArena::Free(const Mesh &mesh)
+{
+    std::lock_guard lock(mMutex);
+
+    vmaVirtualFree(mVertexBlock, mesh.VertexAllocation);
+    vmaVirtualFree(mIndexBlock, mesh.IndexAllocation);
+}
+
+void GeometryArena::Bind(VkCommandBuffer commandBuffer) const
+{
+    VkDeviceSize offset = 0;
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, &mVertexBuffer.Handle, &offset);
+
+    vkCmdBindIndexBuffer(commandBuffer, mIndexBuffer.Handle, 0, VK_INDEX_TYPE_UINT32);
+}
+
+void GeometryArena::PushPullConstants(VkCommandBuffer commandBuffer,
+                                      VkPipelineLayout layout,
+                                      VkDeviceSize vertexStride) const
+{
+    PullConstants constants{
+        .Vertices = mVertexAddress,
+        .VertexStride = static_cast<uint32_t>(vertexStride / sizeof(float)),
+    };
+
+    vkCmdPushConstants(commandBuffer, layout, VK_SHADER_STAGE_VERTEX_BIT, 0,
+                       sizeof(constants), &constants);
+}
\ No newline at end of file
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "Buffer.h"
+#include "VulkanContext.h"
+
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <vector>
+
+/**
+    One large vertex buffer and one 32-bit index buffer shared by all renderers.
+    Ranges are suballocated with VMA virtual blocks (TLSF), so meshes are just
+    offsets into the shared buffers and all of them are drawn after binding the
+    arena once. Vertex layouts may differ between meshes, as long as pipelines
+    read vertex binding 0 or pull vertices through the buffer device address
+    (see PushPullConstants). Uploads and frees are thread safe, since renderers
+    get constructed on a background thread.
+*/
+class GeometryArena {
+  public:
+    static constexpr VkDeviceSize DEFAULT_VERTEX_CAPACITY = 64ull << 20;
+    static constexpr VkDeviceSize DEFAULT_INDEX_CAPACITY = 32ull << 20;
+
+    // Arguments of vkCmdDrawIndexed for the whole mesh:
+    struct Mesh {
+        // In vertices of the mesh's own stride:
+        int32_t VertexOffset = 0;
+        uint32_t FirstIndex = 0;
+        uint32_t IndexCount = 0;
+
+        VmaVirtualAllocation VertexAllocation = VK_NULL_HANDLE;
+        VmaVirtualAllocation IndexAllocation = VK_NULL_HANDLE;
+    };
+
+    // Matches the push constant block of assets/shaders/VertexPulling.glsl:
+    struct PullConstants {
+        VkDeviceAddress Vertices;
+        // In floats:
+        uint32_t VertexStride;
+    };
+
+    struct UploadInfo {
+        VkQueue Queue;
+        VkCommandPool Pool;
+        const void *Vertices;
+        size_t VertexCount;
+        VkDeviceSize VertexStride;
+        // Relative to the first vertex of the mesh:
+        std::span<const uint32_t> Indices;
+    };
+
+    explicit GeometryArena(VulkanContext &ctx,
+                           VkDeviceSize vertexCapacity = DEFAULT_VERTEX_CAPACITY,
+                           VkDeviceSize indexCapacity = DEFAULT_INDEX_CAPACITY);
+    ~GeometryArena();
+
+    GeometryArena(const GeometryArena &) = delete;
+    GeometryArena &operator=(const GeometryArena &) = delete;
+
+    // Written in place if the arena is host visible, otherwise staged and
+    // blocks until the copy is done:
+    Mesh Upload(const UploadInfo &info);
+
+    template <typename Vertex>
+    Mesh Upload(VkQueue queue, VkCommandPool pool, const std::vector<Vertex> &vertices,
+                std::span<const uint32_t> indices)
+    {
+        return Upload(UploadInfo{
+            .Queue = queue,
+            .Pool = pool,
+            .Vertices = vertices.data(),
+            .VertexCount = vertices.size(),
+            .VertexStride = sizeof(Vertex),
+            .Indices = indices,
+        });
+    }
+
+    // Mesh must no longer be used by any submitted work:
+    void Free(const Mesh &mesh);
+
+    // Binds the vertex buffer to binding 0 and the index buffer:
+    void Bind(VkCommandBuffer commandBuffer) const;
+
+    // For pipelines built with PullConstants in the vertex stage push constants.
+    // Indices still come from the bound index buffer:
+    void PushPullConstants(VkCommandBuffer commandBuffer, VkPipelineLayout layout,
+                           VkDeviceSize vertexStride) const;
+
+    // Also usable from compute shaders writing geometry consumed by draws:
+    [[nodiscard]] VkDeviceAddress VertexAddress() const
+    {
+        return mVertexAddress;
+    }
+    [[nodiscard]] VkDeviceAddress IndexAddress() const
+    {
+        return mIndexAddress;
+    }
+
+  private:
+    VulkanContext &ctx;
+
+    Buffer mVertexBuffer;
+    Buffer mIndexBuffer;
+    bool mHostVisible = false;
+
+    VkDeviceAddress mVertexAddress = 0;
+    VkDeviceAddress mIndexAddress = 0;
+
+    // Guards both blocks:
+    std::mutex mMutex;
+    VmaVirtualBlock mVertexBlock;
+    VmaVirtualBlock mIndexBlock;
+};
\ No newline at end of file
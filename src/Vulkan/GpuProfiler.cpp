@@ -0,0 +1,245 @@
+#include "GpuProfiler.h"
+
+#include <array>
+#include <cstdio>
+#include <stdexcept>
+
+// Order of results matches the order of bits:
+static constexpr VkQueryPipelineStatisticFlags STATISTICS_FLAGS =
+    VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+
+static constexpr size_t STATISTICS_COUNT = 3;
+
+void GpuProfiler::Init(VulkanContext &ctx, size_t framesInFlight)
+{
+    mFrames.resize(framesInFlight);
+
+    auto &limits = ctx.PhysicalDevice.properties.limits;
+
+    auto family = ctx.Device.get_queue_index(vkb::QueueType::graphics).value();
+    auto validBits = ctx.PhysicalDevice.get_queue_families()[family].timestampValidBits;
+
+    // Profiling silently turns off when timestamps are not supported:
+    if (!limits.timestampComputeAndGraphics || validBits == 0)
+        return;
+
+    mTimestampPeriod = limits.timestampPeriod;
+    mTimestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+    const auto zoneCount = static_cast<uint32_t>(framesInFlight) * MAX_ZONES;
+
+    VkQueryPoolCreateInfo timestampInfo{};
+    timestampInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    timestampInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    timestampInfo.queryCount = 2 * zoneCount;
+
+    if (vkCreateQueryPool(ctx.Device, &timestampInfo, nullptr, &mTimestampPool) !=
+        VK_SUCCESS)
+        throw std::runtime_error("Failed to create a query pool!");
+
+    vkResetQueryPool(ctx.Device, mTimestampPool, 0, timestampInfo.queryCount);
+
+    if (ctx.PipelineStatisticsSupported)
+    {
+        VkQueryPoolCreateInfo statisticsInfo{};
+        statisticsInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        statisticsInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+        statisticsInfo.queryCount = zoneCount;
+        statisticsInfo.pipelineStatistics = STATISTICS_FLAGS;
+
+        if (vkCreateQueryPool(ctx.Device, &statisticsInfo, nullptr, &mStatisticsPool) !=
+            VK_SUCCESS)
+            throw std::runtime_error("Failed to create a query pool!");
+
+        vkResetQueryPool(ctx.Device, mStatisticsPool, 0, statisticsInfo.queryCount);
+    }
+}
+
+void GpuProfiler::Destroy(VulkanContext &ctx)
+{
+    if (mTimestampPool != VK_NULL_HANDLE)
+        vkDestroyQueryPool(ctx.Device, mTimestampPool, nullptr);
+
+    if (mStatisticsPool != VK_NULL_HANDLE)
+        vkDestroyQueryPool(ctx.Device, mStatisticsPool, nullptr);
+
+    mTimestampPool = VK_NULL_HANDLE;
+    mStatisticsPool = VK_NULL_HANDLE;
+}
+
+void GpuProfiler::BeginFrame(VulkanContext &ctx, size_t frameIndex)
+{
+    mCurrentFrame = frameIndex;
+    mActiveStatisticsZone = INVALID_ZONE;
+
+    if (!Enabled())
+        return;
+
+    auto &frame = mFrames[frameIndex];
+    const auto base = static_cast<uint32_t>(frameIndex) * MAX_ZONES;
+
+    // Fence of this frame has signalled, so results should be ready.
+    // Availability is still checked, to never stall on a zone that
+    // didn't make it into a submission.
+    if (!frame.Zones.empty())
+        mResults.clear();
+
+    for (uint32_t i = 0; i < frame.Zones.size(); i++)
+    {
+        auto &zone = frame.Zones[i];
+
+        if (!zone.Ended)
+            continue;
+
+        // Pairs of (value, availability):
+        std::array<uint64_t, 4> timestamps{};
+
+        vkGetQueryPoolResults(ctx.Device, mTimestampPool, 2 * (base + i), 2,
+                              sizeof(timestamps), timestamps.data(),
+                              2 * sizeof(uint64_t),
+                              VK_QUERY_RESULT_64_BIT |
+                                  VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+        if (timestamps[1] == 0 || timestamps[3] == 0)
+            continue;
+
+        auto ticks = (timestamps[2] - timestamps[0]) & mTimestampMask;
+        auto ns = static_cast<double>(ticks) * mTimestampPeriod;
+        auto ms = static_cast<float>(1e-6 * ns);
+
+        auto [avg, inserted] = mAverages.try_emplace(zone.Name, ms);
+        if (!inserted)
+            avg->second = 0.95f * avg->second + 0.05f * ms;
+
+        GpuZoneResult result{
+            .Name = zone.Name,
+            .Milliseconds = ms,
+            .AverageMilliseconds = avg->second,
+        };
+
+        if (zone.StatisticsQuery != INVALID_ZONE)
+        {
+            std::array<uint64_t, STATISTICS_COUNT + 1> stats{};
+
+            const auto query = base + zone.StatisticsQuery;
+
+            vkGetQueryPoolResults(ctx.Device, mStatisticsPool, query, 1, sizeof(stats),
+                                  stats.data(), sizeof(stats),
+                                  VK_QUERY_RESULT_64_BIT |
+                                      VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+            if (stats[STATISTICS_COUNT] != 0)
+            {
+                result.HasStatistics = true;
+                result.VertexInvocations = stats[0];
+                result.FragmentInvocations = stats[1];
+                result.ComputeInvocations = stats[2];
+            }
+        }
+
+        mResults.push_back(result);
+    }
+
+    // Queries need a reset before reuse, done from the host since
+    // this frame's command buffers are not recorded yet:
+    vkResetQueryPool(ctx.Device, mTimestampPool, 2 * base, 2 * MAX_ZONES);
+
+    if (StatisticsSupported())
+        vkResetQueryPool(ctx.Device, mStatisticsPool, base, MAX_ZONES);
+
+    frame.Zones.clear();
+    frame.StatisticsCount = 0;
+}
+
+uint32_t GpuProfiler::BeginGpuZone(VkCommandBuffer cmd, std::string_view name,
+                                   bool statistics)
+{
+    if (!Enabled())
+        return INVALID_ZONE;
+
+    auto &frame = mFrames[mCurrentFrame];
+
+    if (frame.Zones.size() >= MAX_ZONES)
+        return INVALID_ZONE;
+
+    const auto base = static_cast<uint32_t>(mCurrentFrame) * MAX_ZONES;
+    const auto zone = static_cast<uint32_t>(frame.Zones.size());
+
+    frame.Zones.push_back(Zone{.Name = std::string(name)});
+
+    vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, mTimestampPool,
+                        2 * (base + zone));
+
+    if (statistics && StatisticsSupported() && mActiveStatisticsZone == INVALID_ZONE)
+    {
+        auto query = frame.StatisticsCount++;
+        frame.Zones.back().StatisticsQuery = query;
+        mActiveStatisticsZone = zone;
+
+        vkCmdBeginQuery(cmd, mStatisticsPool, base + query, 0);
+    }
+
+    return zone;
+}
+
+void GpuProfiler::EndGpuZone(VkCommandBuffer cmd, uint32_t zone)
+{
+    if (zone == INVALID_ZONE)
+        return;
+
+    auto &frame = mFrames[mCurrentFrame];
+    const auto base = static_cast<uint32_t>(mCurrentFrame) * MAX_ZONES;
+
+    if (mActiveStatisticsZone == zone)
+    {
+        vkCmdEndQuery(cmd, mStatisticsPool, base + frame.Zones[zone].StatisticsQuery);
+        mActiveStatisticsZone = INVALID_ZONE;
+    }
+
+    vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, mTimestampPool,
+                        2 * (base + zone) + 1);
+
+    frame.Zones[zone].Ended = true;
+}
+
+std::string GpuProfiler::Report() const
+{
+    std::string report;
+
+    for (auto &result : mResults)
+    {
+        std::array<char, 256> line{};
+
+        std::snprintf(line.data(), line.size(), "%-24s %8.4f ms (avg %8.4f ms)",
+                      result.Name.c_str(), result.Milliseconds,
+                      result.AverageMilliseconds);
+        report += line.data();
+
+        if (result.HasStatistics)
+        {
+            std::snprintf(line.data(), line.size(), "  vs: %llu, fs: %llu, cs: %llu",
+                          static_cast<unsigned long long>(result.VertexInvocations),
+                          static_cast<unsigned long long>(result.FragmentInvocations),
+                          static_cast<unsigned long long>(result.ComputeInvocations));
+            report += line.data();
+        }
+
+        report += '\n';
+    }
+
+    return report;
+}
+
+GpuZone::GpuZone(GpuProfiler &profiler, VkCommandBuffer cmd, std::string_view name,
+                 bool statistics)
+    : mProfiler(profiler), mCmd(cmd)
+{
+    mZone = mProfiler.BeginGpuZone(mCmd, name, statistics);
+}
+
+GpuZone::~GpuZone()
+{
+    mProfiler.EndGpuZone(mCmd, mZone);
+}
\ No newline at end of file
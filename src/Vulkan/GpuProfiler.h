@@ -0,0 +1,105 @@
+#pragma once
+
+#include "VulkanContext.h"
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+struct GpuZoneResult {
+    std::string Name;
+    float Milliseconds;
+    // Exponential moving average over previous frames:
+    float AverageMilliseconds;
+
+    bool HasStatistics = false;
+    uint64_t VertexInvocations = 0;
+    uint64_t FragmentInvocations = 0;
+    uint64_t ComputeInvocations = 0;
+};
+
+/**
+    Manages timestamp and pipeline statistics query pools, with a separate
+    range of queries for each frame in flight. Results of a frame are read
+    without stalling in BeginFrame, which must be called after the frame's
+    fence has signalled and before recording any zones for it.
+*/
+class GpuProfiler {
+  public:
+    GpuProfiler() = default;
+
+    void Init(VulkanContext &ctx, size_t framesInFlight);
+    void Destroy(VulkanContext &ctx);
+
+    void BeginFrame(VulkanContext &ctx, size_t frameIndex);
+
+    // Zones must not cross render pass boundaries if statistics are requested.
+    // Statistics queries can't nest, inner zones only get timings.
+    uint32_t BeginGpuZone(VkCommandBuffer cmd, std::string_view name,
+                          bool statistics = false);
+    void EndGpuZone(VkCommandBuffer cmd, uint32_t zone);
+
+    [[nodiscard]] const std::vector<GpuZoneResult> &Results() const
+    {
+        return mResults;
+    }
+
+    [[nodiscard]] bool Enabled() const
+    {
+        return mTimestampPool != VK_NULL_HANDLE;
+    }
+
+    [[nodiscard]] bool StatisticsSupported() const
+    {
+        return mStatisticsPool != VK_NULL_HANDLE;
+    }
+
+    [[nodiscard]] std::string Report() const;
+
+  private:
+    static constexpr uint32_t MAX_ZONES = 32;
+    static constexpr uint32_t INVALID_ZONE = ~0u;
+
+    VkQueryPool mTimestampPool = VK_NULL_HANDLE;
+    VkQueryPool mStatisticsPool = VK_NULL_HANDLE;
+
+    float mTimestampPeriod = 1.0f;
+    uint64_t mTimestampMask = ~0ull;
+
+    struct Zone {
+        std::string Name;
+        // Index of the statistics query, or INVALID_ZONE:
+        uint32_t StatisticsQuery = INVALID_ZONE;
+        bool Ended = false;
+    };
+
+    struct FrameQueries {
+        std::vector<Zone> Zones;
+        uint32_t StatisticsCount = 0;
+    };
+
+    std::vector<FrameQueries> mFrames;
+    size_t mCurrentFrame = 0;
+
+    uint32_t mActiveStatisticsZone = INVALID_ZONE;
+
+    std::vector<GpuZoneResult> mResults;
+    std::unordered_map<std::string, float> mAverages;
+};
+
+/// Scoped helper, ends the zone when going out of scope.
+class GpuZone {
+  public:
+    GpuZone(GpuProfiler &profiler, VkCommandBuffer cmd, std::string_view name,
+            bool statistics = false);
+    ~GpuZone();
+
+    GpuZone(const GpuZone &) = delete;
+    GpuZone &operator=(const GpuZone &) = delete;
+
+  private:
+    GpuProfiler &mProfiler;
+    VkCommandBuffer mCmd;
+    uint32_t mZone;
+};
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "Image.h"
 
 #include "Buffer.h"
+#include "FrameStats.h"
 #include "Utils.h"
 
 Image Image::CreateImage(VulkanContext &ctx, ImageInfo info)
@@ -31,9 +32,18 @@ Image Image::CreateImage(VulkanContext &ctx, ImageInfo info)
 
     VmaAllocationCreateInfo allocCreateInfo = {};
     allocCreateInfo.usage = VMA_MEMORY_USAGE_AUTO;
-    allocCreateInfo.flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+    allocCreateInfo.requiredFlags = info.Properties;
+    allocCreateInfo.pool = info.MemoryPool;
     allocCreateInfo.priority = 1.0f;
 
+    // Render targets are large and get recreated on resize, so they get
+    // their own memory. Everything else is suballocated:
+    constexpr VkImageUsageFlags attachmentUsage =
+        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+
+    if (info.MemoryPool == VK_NULL_HANDLE && (info.Usage & attachmentUsage))
+        allocCreateInfo.flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+
     vmaCreateImage(ctx.Allocator, &imageInfo, &allocCreateInfo, &img.Handle,
                    &img.Allocation, nullptr);
 
@@ -47,6 +57,8 @@ void Image::DestroyImage(VulkanContext &ctx, Image &img)
 
 void Image::UploadToImage(VulkanContext &ctx, Image &img, ImageDataInfo info)
 {
+    ScopedFramePhase phase(FramePhase::Upload);
+
     Buffer stagingBuffer = Buffer::CreateStagingBuffer(ctx, info.Size);
 
     Buffer::UploadToBuffer(ctx, stagingBuffer, info.Data, info.Size);
@@ -10,6 +10,8 @@ struct ImageInfo {
     VkImageTiling Tiling;
     VkImageUsageFlags Usage;
     VkMemoryPropertyFlags Properties;
+    // Custom pool to allocate from (e.g. MemoryPools::Textures), default if null:
+    VmaPool MemoryPool = VK_NULL_HANDLE;
 };
 
 struct ImageDataInfo {
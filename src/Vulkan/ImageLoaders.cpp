@@ -1,10 +1,13 @@
 #include "ImageLoaders.h"
+#include "Profiler.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
 Image ImageLoaders::LoadImage2D(VulkanContext &ctx, ImageLoaderInfo &info)
 {
+    PROFILE_SCOPE("ImageLoaders::LoadImage2D");
+
     int texWidth, texHeight, texChannels;
     stbi_uc *pixels = stbi_load(info.Filepath.c_str(), &texWidth, &texHeight,
                                 &texChannels, STBI_rgb_alpha);
@@ -26,6 +29,7 @@ Image ImageLoaders::LoadImage2D(VulkanContext &ctx, ImageLoaderInfo &info)
         .Tiling = VK_IMAGE_TILING_OPTIMAL,
         .Usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
         .Properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        .MemoryPool = info.MemoryPool,
     };
 
     Image img = Image::CreateImage(ctx, img_info);
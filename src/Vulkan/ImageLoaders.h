@@ -8,6 +8,8 @@ struct ImageLoaderInfo {
     VkQueue Queue;
     VkCommandPool Pool;
     std::string Filepath;
+    // Custom pool for the image, e.g. MemoryPools::Textures:
+    VmaPool MemoryPool = VK_NULL_HANDLE;
 };
 
 namespace ImageLoaders
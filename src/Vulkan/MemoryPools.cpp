@@ -0,0 +1,96 @@
+#include "MemoryPools.h"
+
+#include "Buffer.h"
+
+#include <stdexcept>
+
+static VmaPool CreatePool(VulkanContext &ctx, uint32_t memoryType,
+                          VmaPoolCreateFlags flags, const char *name)
+{
+    VmaPoolCreateInfo poolInfo{};
+    poolInfo.memoryTypeIndex = memoryType;
+    poolInfo.flags = flags;
+    // Block size is left to VMA, which starts with smaller blocks for small pools:
+    poolInfo.blockSize = 0;
+
+    VmaPool pool;
+
+    if (vmaCreatePool(ctx.Allocator, &poolInfo, &pool) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create a memory pool!");
+
+    // Shows up in the statistics json:
+    vmaSetPoolName(ctx.Allocator, pool, name);
+
+    return pool;
+}
+
+void MemoryPools::Init(VulkanContext &ctx)
+{
+    // Memory types are picked for representative resources, with the
+    // expectation that all resources of the same kind share them:
+    VmaAllocationCreateInfo allocInfo{};
+    allocInfo.usage = VMA_MEMORY_USAGE_AUTO;
+    allocInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+    // Geometry:
+    {
+        VkBufferCreateInfo bufferInfo{};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size = 1024;
+        bufferInfo.usage =
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        // Same flags as Buffer::CreateGPUBuffer, so with ReBAR the pool is host
+        // visible and geometry uploads skip staging:
+        VmaAllocationCreateInfo geometryAllocInfo = allocInfo;
+        geometryAllocInfo.flags = Buffer::DirectUploadFlags(ctx);
+
+        uint32_t memoryType;
+
+        if (vmaFindMemoryTypeIndexForBufferInfo(ctx.Allocator, &bufferInfo,
+                                                &geometryAllocInfo,
+                                                &memoryType) != VK_SUCCESS)
+            throw std::runtime_error("Failed to find memory type for geometry!");
+
+        // Geometry is freed all at once (or in reverse order), which the linear
+        // algorithm handles without any free-list bookkeeping:
+        Geometry = CreatePool(ctx, memoryType, VMA_POOL_CREATE_LINEAR_ALGORITHM_BIT,
+                              "Renderer geometry");
+    }
+
+    // Textures:
+    {
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.extent = {1024, 1024, 1};
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.format = VK_FORMAT_R8G8B8A8_SRGB;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+
+        uint32_t memoryType;
+
+        if (vmaFindMemoryTypeIndexForImageInfo(ctx.Allocator, &imageInfo, &allocInfo,
+                                               &memoryType) != VK_SUCCESS)
+            throw std::runtime_error("Failed to find memory type for textures!");
+
+        Textures = CreatePool(ctx, memoryType, 0, "Renderer textures");
+    }
+}
+
+void MemoryPools::Destroy(VulkanContext &ctx)
+{
+    vmaDestroyPool(ctx.Allocator, Geometry);
+    vmaDestroyPool(ctx.Allocator, Textures);
+
+    Geometry = VK_NULL_HANDLE;
+    Textures = VK_NULL_HANDLE;
+}
\ No newline at end of file
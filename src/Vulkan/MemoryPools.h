@@ -0,0 +1,25 @@
+#pragma once
+
+#include "VulkanContext.h"
+
+/**
+    Custom VMA pools owned by a single renderer. Static geometry is placed
+    in a linear pool and sampled textures in a block pool, so resources of
+    a renderer share a few large memory blocks, freed all at once in Destroy
+    instead of one vkFreeMemory per resource. Allocations made from the pools
+    must be freed before that. Render targets don't use the pools, they get
+    dedicated allocations (see Image::CreateImage).
+*/
+class MemoryPools {
+  public:
+    MemoryPools() = default;
+
+    void Init(VulkanContext &ctx);
+    void Destroy(VulkanContext &ctx);
+
+  public:
+    // Vertex, index, storage and indirect buffers, device local:
+    VmaPool Geometry = VK_NULL_HANDLE;
+    // Optimal tiling sampled images with 8-bit color formats, device local:
+    VmaPool Textures = VK_NULL_HANDLE;
+};
\ No newline at end of file
@@ -0,0 +1,115 @@
+#include "ParallelRecorder.h"
+
+#include "Profiler.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+ParallelRecorder::ParallelRecorder(JobSystem &jobs) : mJobs(jobs)
+{
+}
+
+void ParallelRecorder::Init(VulkanContext &ctx, size_t framesInFlight)
+{
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex =
+        ctx.Device.get_queue_index(vkb::QueueType::graphics).value();
+
+    mPools.resize(framesInFlight * NumThreads());
+
+    for (auto &pool : mPools)
+    {
+        if (vkCreateCommandPool(ctx.Device, &poolInfo, nullptr, &pool.Pool) !=
+            VK_SUCCESS)
+            throw std::runtime_error("Failed to create a command pool!");
+    }
+}
+
+void ParallelRecorder::Destroy(VulkanContext &ctx)
+{
+    // Frees the command buffers as well:
+    for (auto &pool : mPools)
+        vkDestroyCommandPool(ctx.Device, pool.Pool, nullptr);
+
+    mPools.clear();
+}
+
+void ParallelRecorder::BeginFrame(VulkanContext &ctx, size_t frameIndex)
+{
+    mFrameIndex = frameIndex;
+
+    for (size_t chunk = 0; chunk < NumThreads(); chunk++)
+    {
+        auto &pool = mPools[mFrameIndex * NumThreads() + chunk];
+
+        vkResetCommandPool(ctx.Device, pool.Pool, 0);
+        pool.Used = 0;
+    }
+}
+
+std::span<const VkCommandBuffer> ParallelRecorder::Record(
+    VulkanContext &ctx, const VkCommandBufferInheritanceRenderingInfo &rendering,
+    size_t numChunks, const RecordFunction &record)
+{
+    PROFILE_SCOPE("ParallelRecorder::Record");
+
+    numChunks = std::clamp<size_t>(numChunks, 1, NumThreads());
+
+    mCtx = &ctx;
+    mRendering = &rendering;
+    mRecord = &record;
+    mResults.assign(numChunks, VK_NULL_HANDLE);
+
+    // One chunk per batch, the first one is recorded on the calling thread:
+    mJobs.ParallelFor(numChunks, 1, [this](size_t chunk, size_t) { RecordChunk(chunk); });
+
+    return mResults;
+}
+
+void ParallelRecorder::RecordChunk(size_t chunk)
+{
+    PROFILE_SCOPE("ParallelRecorder::RecordChunk");
+
+    auto &ctx = *mCtx;
+    auto &pool = mPools[mFrameIndex * NumThreads() + chunk];
+
+    if (pool.Used == pool.Buffers.size())
+    {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = pool.Pool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocInfo.commandBufferCount = 1;
+
+        VkCommandBuffer buffer;
+
+        if (vkAllocateCommandBuffers(ctx.Device, &allocInfo, &buffer) != VK_SUCCESS)
+            throw std::runtime_error("Failed to allocate command buffers!");
+
+        pool.Buffers.push_back(buffer);
+    }
+
+    VkCommandBuffer buffer = pool.Buffers[pool.Used++];
+
+    VkCommandBufferInheritanceInfo inheritanceInfo{};
+    inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritanceInfo.pNext = mRendering;
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT |
+                      VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+    if (vkBeginCommandBuffer(buffer, &beginInfo) != VK_SUCCESS)
+        throw std::runtime_error("Failed to begin recording command buffer!");
+
+    (*mRecord)(buffer, chunk);
+
+    if (vkEndCommandBuffer(buffer) != VK_SUCCESS)
+        throw std::runtime_error("Failed to record command buffer!");
+
+    mResults[chunk] = buffer;
+}
\ No newline at end of file
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "JobSystem.h"
+#include "VulkanContext.h"
+
+#include <cstddef>
+#include <functional>
+#include <span>
+#include <vector>
+
+/**
+    Records secondary command buffers for a dynamic rendering pass as jobs
+    of the shared JobSystem. Each chunk owns a transient command pool for every
+    frame in flight, and a chunk is recorded by a single thread, so pools are
+    never used concurrently and all buffers of a frame are recycled at once in BeginFrame.
+*/
+class ParallelRecorder {
+  public:
+    // Called with a begun secondary buffer and the index of the chunk to record:
+    using RecordFunction = std::function<void(VkCommandBuffer, size_t)>;
+
+    explicit ParallelRecorder(JobSystem &jobs);
+
+    ParallelRecorder(const ParallelRecorder &) = delete;
+    ParallelRecorder &operator=(const ParallelRecorder &) = delete;
+
+    void Init(VulkanContext &ctx, size_t framesInFlight);
+    void Destroy(VulkanContext &ctx);
+
+    // Must be called after the GPU has finished the previous use of the frame:
+    void BeginFrame(VulkanContext &ctx, size_t frameIndex);
+
+    // Records numChunks (at most NumThreads()) secondary buffers in parallel,
+    // chunk 0 on the calling thread. Buffers are returned in chunk order and
+    // stay valid until the next BeginFrame of the same frame:
+    std::span<const VkCommandBuffer> Record(
+        VulkanContext &ctx, const VkCommandBufferInheritanceRenderingInfo &rendering,
+        size_t numChunks, const RecordFunction &record);
+
+    [[nodiscard]] size_t NumThreads() const
+    {
+        return mJobs.NumThreads();
+    }
+
+  private:
+    void RecordChunk(size_t chunk);
+
+  private:
+    struct ChunkPool {
+        VkCommandPool Pool = VK_NULL_HANDLE;
+        // Kept across resets, since resetting the pool recycles them as well:
+        std::vector<VkCommandBuffer> Buffers;
+        size_t Used = 0;
+    };
+
+    // Indexed by frame * NumThreads() + chunk:
+    std::vector<ChunkPool> mPools;
+    size_t mFrameIndex = 0;
+
+    JobSystem &mJobs;
+
+    // State of the current Record call, written before submitting the jobs:
+    VulkanContext *mCtx = nullptr;
+    const VkCommandBufferInheritanceRenderingInfo *mRendering = nullptr;
+    const RecordFunction *mRecord = nullptr;
+    std::vector<VkCommandBuffer> mResults;
+};
\ No newline at end of file
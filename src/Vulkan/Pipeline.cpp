@@ -1,5 +1,7 @@
 #include "Pipeline.h"
 
+#include "FrameStats.h"
+
 PipelineBuilder::PipelineBuilder()
 {
     mVertexInput = {};
@@ -136,8 +138,21 @@ PipelineBuilder PipelineBuilder::EnableBlending()
     return *this;
 }
 
+PipelineBuilder PipelineBuilder::SetPushConstants(VkShaderStageFlags stages,
+                                                  uint32_t size)
+{
+    mPushConstants = VkPushConstantRange{
+        .stageFlags = stages,
+        .offset = 0,
+        .size = size,
+    };
+    return *this;
+}
+
 Pipeline PipelineBuilder::Build(VulkanContext &ctx, VkDescriptorSetLayout &descriptor)
 {
+    ScopedFramePhase phase(FramePhase::PipelineBuild);
+
     Pipeline pipeline;
 
     // Layout
@@ -145,7 +160,8 @@ Pipeline PipelineBuilder::Build(VulkanContext &ctx, VkDescriptorSetLayout &descr
     pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
     pipelineLayoutInfo.setLayoutCount = 1;
     pipelineLayoutInfo.pSetLayouts = &descriptor;
-    pipelineLayoutInfo.pushConstantRangeCount = 0;
+    pipelineLayoutInfo.pushConstantRangeCount = mPushConstants ? 1 : 0;
+    pipelineLayoutInfo.pPushConstantRanges = mPushConstants ? &*mPushConstants : nullptr;
 
     if (vkCreatePipelineLayout(ctx.Device, &pipelineLayoutInfo, nullptr,
                                &pipeline.Layout) != VK_SUCCESS)
@@ -193,6 +209,9 @@ Pipeline PipelineBuilder::Build(VulkanContext &ctx, VkDescriptorSetLayout &descr
         // pipelineRenderingCreateInfo.stencilAttachmentFormat = mDepthStencilFormat;
     }
 
+    // Setters return copies, so the builder may be a copy of the one this pointed to:
+    mColorBlend.pAttachments = &mColorBlendAttachment;
+
     // Pipeline creation
     VkGraphicsPipelineCreateInfo pipelineInfo = {};
     pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
@@ -225,6 +244,8 @@ Pipeline PipelineBuilder::Build(VulkanContext &ctx, VkDescriptorSetLayout &descr
 Pipeline ComputePipelineBuilder::Build(VulkanContext &ctx,
                                        VkDescriptorSetLayout &descriptor)
 {
+    ScopedFramePhase phase(FramePhase::PipelineBuild);
+
     Pipeline pipeline;
 
     VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
@@ -241,6 +262,9 @@ Pipeline ComputePipelineBuilder::Build(VulkanContext &ctx,
     pipelineInfo.layout = pipeline.Layout;
     pipelineInfo.stage = mShaderStage;
 
+    if (!mSpecialization.Empty())
+        pipelineInfo.stage.pSpecializationInfo = mSpecialization.Info();
+
     if (vkCreateComputePipelines(ctx.Device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr,
                                  &pipeline.Handle) != VK_SUCCESS)
         throw std::runtime_error("Failed to create compute pipeline!");
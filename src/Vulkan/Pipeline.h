@@ -1,7 +1,9 @@
 #pragma once
 
+#include "Shader.h"
 #include "VulkanContext.h"
 
+#include <optional>
 #include <vector>
 
 struct Pipeline {
@@ -35,6 +37,9 @@ class PipelineBuilder {
 
     PipelineBuilder EnableBlending();
 
+    // Single range starting at offset 0:
+    PipelineBuilder SetPushConstants(VkShaderStageFlags stages, uint32_t size);
+
     Pipeline Build(VulkanContext &ctx, VkDescriptorSetLayout &descriptor);
 
   private:
@@ -52,6 +57,8 @@ class PipelineBuilder {
 
     bool mDepthFormatProvided = false;
     VkFormat mDepthFormat;
+
+    std::optional<VkPushConstantRange> mPushConstants;
 };
 
 class ComputePipelineBuilder {
@@ -64,8 +71,17 @@ class ComputePipelineBuilder {
         return *this;
     }
 
+    // Builder keeps its own copy, so constants can be temporaries.
+    // Overrides specialization info set in the shader stage.
+    ComputePipelineBuilder SetSpecialization(SpecializationConstants constants)
+    {
+        mSpecialization = constants;
+        return *this;
+    }
+
     Pipeline Build(VulkanContext &ctx, VkDescriptorSetLayout &descriptor);
 
   private:
     VkPipelineShaderStageCreateInfo mShaderStage;
+    SpecializationConstants mSpecialization;
 };
\ No newline at end of file
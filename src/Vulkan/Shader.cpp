@@ -44,6 +44,16 @@ static VkShaderModule CreateShaderModule(VulkanContext &ctx,
     return shaderModule;
 }
 
+const VkSpecializationInfo *SpecializationConstants::Info()
+{
+    mInfo.mapEntryCount = static_cast<uint32_t>(mEntries.size());
+    mInfo.pMapEntries = mEntries.data();
+    mInfo.dataSize = mData.size();
+    mInfo.pData = mData.data();
+
+    return &mInfo;
+}
+
 std::vector<VkPipelineShaderStageCreateInfo> ShaderBuilder::Build(VulkanContext &ctx)
 {
     if (mComputePath.has_value())
@@ -84,12 +94,14 @@ std::vector<VkPipelineShaderStageCreateInfo> ShaderBuilder::BuildGraphics(
     vertStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
     vertStageInfo.module = vertModule;
     vertStageInfo.pName = "main";
+    vertStageInfo.pSpecializationInfo = mVertexSpecialization;
 
     VkPipelineShaderStageCreateInfo fragStageInfo = {};
     fragStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     fragStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
     fragStageInfo.module = fragModule;
     fragStageInfo.pName = "main";
+    fragStageInfo.pSpecializationInfo = mFragmentSpecialization;
 
     return std::vector<VkPipelineShaderStageCreateInfo>{vertStageInfo, fragStageInfo};
 }
@@ -108,6 +120,7 @@ std::vector<VkPipelineShaderStageCreateInfo> ShaderBuilder::BuildCompute(
     computeStageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
     computeStageInfo.module = computeModule;
     computeStageInfo.pName = "main";
+    computeStageInfo.pSpecializationInfo = mComputeSpecialization;
 
     return std::vector<VkPipelineShaderStageCreateInfo>{computeStageInfo};
 }
\ No newline at end of file
@@ -2,9 +2,51 @@
 
 #include <optional>
 #include <string>
+#include <type_traits>
+#include <vector>
 
 #include "VulkanContext.h"
 
+/**
+    Storage for specialization constant values. Pointer returned by Info()
+    stays valid as long as this object is alive and no constants are added.
+*/
+class SpecializationConstants {
+  public:
+    SpecializationConstants() = default;
+
+    template <typename T>
+    SpecializationConstants &Add(uint32_t constantID, const T &value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+
+        VkSpecializationMapEntry entry{};
+        entry.constantID = constantID;
+        entry.offset = static_cast<uint32_t>(mData.size());
+        entry.size = sizeof(T);
+
+        mEntries.push_back(entry);
+
+        auto bytes = reinterpret_cast<const char *>(&value);
+        mData.insert(mData.end(), bytes, bytes + sizeof(T));
+
+        return *this;
+    }
+
+    [[nodiscard]] bool Empty() const
+    {
+        return mEntries.empty();
+    }
+
+    const VkSpecializationInfo *Info();
+
+  private:
+    std::vector<VkSpecializationMapEntry> mEntries;
+    std::vector<char> mData;
+
+    VkSpecializationInfo mInfo{};
+};
+
 class ShaderBuilder {
   public:
     ShaderBuilder() = default;
@@ -26,6 +68,23 @@ class ShaderBuilder {
         return *this;
     }
 
+    // Specialization info needs to outlive pipeline creation:
+    ShaderBuilder SetVertexSpecialization(const VkSpecializationInfo *info)
+    {
+        mVertexSpecialization = info;
+        return *this;
+    }
+    ShaderBuilder SetFragmentSpecialization(const VkSpecializationInfo *info)
+    {
+        mFragmentSpecialization = info;
+        return *this;
+    }
+    ShaderBuilder SetComputeSpecialization(const VkSpecializationInfo *info)
+    {
+        mComputeSpecialization = info;
+        return *this;
+    }
+
     std::vector<VkPipelineShaderStageCreateInfo> Build(VulkanContext &ctx);
 
   private:
@@ -37,4 +96,8 @@ class ShaderBuilder {
     std::optional<std::string> mFragmentPath;
 
     std::optional<std::string> mComputePath;
+
+    const VkSpecializationInfo *mVertexSpecialization = nullptr;
+    const VkSpecializationInfo *mFragmentSpecialization = nullptr;
+    const VkSpecializationInfo *mComputeSpecialization = nullptr;
 };
\ No newline at end of file
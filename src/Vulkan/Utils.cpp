@@ -1,4 +1,5 @@
 #include "Utils.h"
+#include <iostream>
 #include <stdexcept>
 #include <vulkan/vulkan.h>
 
@@ -34,36 +35,115 @@ void utils::CreateSemaphore(VulkanContext &ctx, VkSemaphore &semaphore)
         throw std::runtime_error("Failed to create a semaphore!");
 }
 
+VkSemaphoreSubmitInfo utils::SemaphoreSubmitInfo(VkSemaphore semaphore,
+                                                 VkPipelineStageFlags2 stages,
+                                                 uint64_t value)
+{
+    VkSemaphoreSubmitInfo info{};
+    info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+    info.semaphore = semaphore;
+    info.value = value;
+    info.stageMask = stages;
+    return info;
+}
+
+uint64_t utils::CompletedTimelineValue(VulkanContext &ctx)
+{
+    uint64_t value;
+
+    if (vkGetSemaphoreCounterValue(ctx.Device, ctx.GraphicsTimeline.Semaphore,
+                                   &value) != VK_SUCCESS)
+        throw std::runtime_error("Failed to query timeline semaphore value!");
+
+    return value;
+}
+
+void utils::WaitTimelineValue(VulkanContext &ctx, uint64_t value)
+{
+    VkSemaphoreWaitInfo waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &ctx.GraphicsTimeline.Semaphore;
+    waitInfo.pValues = &value;
+
+    if (vkWaitSemaphores(ctx.Device, &waitInfo, UINT64_MAX) != VK_SUCCESS)
+        throw std::runtime_error("Failed to wait for timeline semaphore!");
+}
+
+VkDeviceSize utils::AllocatedBytes(VulkanContext &ctx)
+{
+    VmaTotalStatistics stats;
+    vmaCalculateStatistics(ctx.Allocator, &stats);
+
+    return stats.total.statistics.allocationBytes;
+}
+
+void utils::DeviceWaitIdle(VulkanContext &ctx)
+{
+    std::lock_guard lock(ctx.QueueMutex);
+    vkDeviceWaitIdle(ctx.Device);
+}
+
 utils::ScopedCommand::ScopedCommand(VulkanContext &ctx, VkQueue queue,
                                     VkCommandPool commandPool)
     : ctx(ctx), mQueue(queue), mCommandPool(commandPool)
 {
+    // Created upfront, since the destructor can't report failures.
+    // Waiting on a fence instead of the queue, so that the queue is only
+    // locked for the duration of the submission:
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    if (vkCreateFence(ctx.Device, &fenceInfo, nullptr, &mFence) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create a fence!");
+
     VkCommandBufferAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
     allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
     allocInfo.commandPool = commandPool;
     allocInfo.commandBufferCount = 1;
 
-    vkAllocateCommandBuffers(ctx.Device, &allocInfo, &Buffer);
+    // The destructor won't run if the constructor throws, so clean up here:
+    if (vkAllocateCommandBuffers(ctx.Device, &allocInfo, &Buffer) != VK_SUCCESS)
+    {
+        vkDestroyFence(ctx.Device, mFence, nullptr);
+        throw std::runtime_error("Failed to allocate a command buffer!");
+    }
 
     VkCommandBufferBeginInfo beginInfo{};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
     beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
-    vkBeginCommandBuffer(Buffer, &beginInfo);
+    if (vkBeginCommandBuffer(Buffer, &beginInfo) != VK_SUCCESS)
+    {
+        vkFreeCommandBuffers(ctx.Device, mCommandPool, 1, &Buffer);
+        vkDestroyFence(ctx.Device, mFence, nullptr);
+        throw std::runtime_error("Failed to begin a command buffer!");
+    }
 }
 
 utils::ScopedCommand::~ScopedCommand()
 {
-    vkEndCommandBuffer(Buffer);
+    VkResult result = vkEndCommandBuffer(Buffer);
 
-    VkSubmitInfo submitInfo{};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &Buffer;
+    if (result == VK_SUCCESS)
+    {
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &Buffer;
+
+        std::lock_guard lock(ctx.QueueMutex);
+        result = vkQueueSubmit(mQueue, 1, &submitInfo, mFence);
+    }
+
+    // The fence is never signalled if nothing was submitted, waiting would hang:
+    if (result == VK_SUCCESS)
+        vkWaitForFences(ctx.Device, 1, &mFence, VK_TRUE, UINT64_MAX);
+    else
+        std::cerr << "Failed to submit a one-time command buffer!\n";
 
-    vkQueueSubmit(mQueue, 1, &submitInfo, VK_NULL_HANDLE);
-    vkQueueWaitIdle(mQueue);
+    vkDestroyFence(ctx.Device, mFence, nullptr);
 
     vkFreeCommandBuffers(ctx.Device, mCommandPool, 1, &Buffer);
 }
@@ -86,6 +166,17 @@ void utils::InsertImageMemoryBarrier(VkCommandBuffer buffer, ImageMemoryBarrierI
                          nullptr, 1, &imageMemoryBarrier);
 }
 
+void utils::InsertMemoryBarrier(VkCommandBuffer buffer, MemoryBarrierInfo info)
+{
+    VkMemoryBarrier memoryBarrier{};
+    memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memoryBarrier.srcAccessMask = info.SrcAccessMask;
+    memoryBarrier.dstAccessMask = info.DstAccessMask;
+
+    vkCmdPipelineBarrier(buffer, info.SrcStageMask, info.DstStageMask, 0, 1,
+                         &memoryBarrier, 0, nullptr, 0, nullptr);
+}
+
 VkFormat utils::FindSupportedFormat(VulkanContext &ctx,
                                     const std::vector<VkFormat> &candidates,
                                     VkImageTiling tiling, VkFormatFeatureFlags features)
@@ -12,6 +12,15 @@ VkQueue GetQueue(VulkanContext &ctx, vkb::QueueType type);
 void CreateSignalledFence(VulkanContext &ctx, VkFence &fence);
 void CreateSemaphore(VulkanContext &ctx, VkSemaphore &semaphore);
 
+// Value is ignored for binary semaphores:
+VkSemaphoreSubmitInfo SemaphoreSubmitInfo(VkSemaphore semaphore,
+                                          VkPipelineStageFlags2 stages,
+                                          uint64_t value = 0);
+
+// Queries/waits on the graphics timeline (see VulkanContext::GraphicsTimeline):
+uint64_t CompletedTimelineValue(VulkanContext &ctx);
+void WaitTimelineValue(VulkanContext &ctx, uint64_t value);
+
 template <typename VertexType>
 VkVertexInputBindingDescription GetBindingDescription(uint32_t binding,
                                                       VkVertexInputRate inputRate)
@@ -23,6 +32,12 @@ VkVertexInputBindingDescription GetBindingDescription(uint32_t binding,
     return bindingDescription;
 }
 
+// Total size of all live VMA allocations:
+VkDeviceSize AllocatedBytes(VulkanContext &ctx);
+
+// vkDeviceWaitIdle requires all queues to be externally synchronized:
+void DeviceWaitIdle(VulkanContext &ctx);
+
 class ScopedCommand {
   public:
     ScopedCommand(VulkanContext &ctx, VkQueue queue, VkCommandPool commandPool);
@@ -35,6 +50,7 @@ class ScopedCommand {
     VulkanContext &ctx;
     VkQueue mQueue;
     VkCommandPool mCommandPool;
+    VkFence mFence;
 };
 
 VkFormat FindSupportedFormat(VulkanContext &ctx, const std::vector<VkFormat> &candidates,
@@ -56,4 +72,13 @@ struct ImageMemoryBarrierInfo {
 };
 
 void InsertImageMemoryBarrier(VkCommandBuffer buffer, ImageMemoryBarrierInfo info);
+
+struct MemoryBarrierInfo {
+    VkAccessFlags SrcAccessMask;
+    VkAccessFlags DstAccessMask;
+    VkPipelineStageFlags SrcStageMask;
+    VkPipelineStageFlags DstStageMask;
+};
+
+void InsertMemoryBarrier(VkCommandBuffer buffer, MemoryBarrierInfo info);
 } // namespace utils
\ No newline at end of file
@@ -1,8 +1,45 @@
 #include "VulkanContext.h"
 
+#include <algorithm>
+#include <utility>
+
+static bool HasHostVisibleVram(VmaAllocator allocator)
+{
+    const VkPhysicalDeviceMemoryProperties *properties = nullptr;
+    vmaGetMemoryProperties(allocator, &properties);
+
+    uint32_t largestHeap = VK_MAX_MEMORY_HEAPS;
+    VkDeviceSize largestSize = 0;
+
+    for (uint32_t i = 0; i < properties->memoryHeapCount; i++)
+    {
+        const auto &heap = properties->memoryHeaps[i];
+
+        if ((heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) && heap.size > largestSize)
+        {
+            largestHeap = i;
+            largestSize = heap.size;
+        }
+    }
+
+    constexpr VkMemoryPropertyFlags hostVisibleVram =
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+
+    for (uint32_t i = 0; i < properties->memoryTypeCount; i++)
+    {
+        const auto &type = properties->memoryTypes[i];
+
+        if (type.heapIndex == largestHeap &&
+            (type.propertyFlags & hostVisibleVram) == hostVisibleVram)
+            return true;
+    }
+
+    return false;
+}
+
 VulkanContext::VulkanContext(uint32_t width, uint32_t height, std::string title,
-                             void *usr_ptr)
-    : Window(width, height, title, usr_ptr)
+                             Settings settings, void *usr_ptr)
+    : Window(width, height, title, usr_ptr), Config(settings)
 {
     // Initialization done using vk-bootstrap, docs available at
     // https://github.com/charles-lunarg/vk-bootstrap/blob/main/docs/getting_started.md
@@ -31,12 +68,21 @@ VulkanContext::VulkanContext(uint32_t width, uint32_t height, std::string title,
     VkPhysicalDeviceFeatures features{};
     features.samplerAnisotropy = true;
 
+    // Allows resetting query pools from the host, used by the gpu profiler:
+    VkPhysicalDeviceVulkan12Features features12{};
+    features12.hostQueryReset = true;
+    features12.timelineSemaphore = true;
+    // Required by Vulkan 1.3, used for vertex pulling:
+    features12.bufferDeviceAddress = true;
+
     VkPhysicalDeviceVulkan13Features features13{};
     features13.dynamicRendering = true;
+    features13.synchronization2 = true;
 
     auto phys_device_ret = vkb::PhysicalDeviceSelector(Instance)
                                .set_surface(Surface)
                                .set_required_features(features)
+                               .set_required_features_12(features12)
                                .set_required_features_13(features13)
                                .select();
 
@@ -45,6 +91,22 @@ VulkanContext::VulkanContext(uint32_t width, uint32_t height, std::string title,
 
     PhysicalDevice = phys_device_ret.value();
 
+    // Optional features:
+    VkPhysicalDeviceFeatures optionalFeatures{};
+    optionalFeatures.pipelineStatisticsQuery = true;
+
+    PipelineStatisticsSupported =
+        PhysicalDevice.enable_features_if_present(optionalFeatures);
+
+    VkPhysicalDeviceFeatures indirectFeatures{};
+    indirectFeatures.multiDrawIndirect = true;
+
+    MultiDrawIndirectSupported =
+        PhysicalDevice.enable_features_if_present(indirectFeatures);
+
+    MemoryBudgetSupported =
+        PhysicalDevice.enable_extension_if_present(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+
     auto device_ret = vkb::DeviceBuilder(PhysicalDevice).build();
 
     if (!device_ret)
@@ -58,18 +120,57 @@ VulkanContext::VulkanContext(uint32_t width, uint32_t height, std::string title,
     allocatorCreateInfo.physicalDevice = PhysicalDevice;
     allocatorCreateInfo.device = Device;
     allocatorCreateInfo.instance = Instance;
+    allocatorCreateInfo.flags = VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT;
+
+    // Otherwise VMA estimates budgets from its own allocations:
+    if (MemoryBudgetSupported)
+        allocatorCreateInfo.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
 
     vmaCreateAllocator(&allocatorCreateInfo, &Allocator);
 
+    // Without resizable BAR only a 256 MiB window of VRAM is host visible,
+    // which is too small (and too contended) to put static resources in:
+    DirectUploadSupported = HasHostVisibleVram(Allocator);
+
+    // Timeline semaphore for frame synchronization:
+    VkSemaphoreTypeCreateInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    timelineInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    timelineInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &timelineInfo;
+
+    if (vkCreateSemaphore(Device, &semaphoreInfo, nullptr,
+                          &GraphicsTimeline.Semaphore) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create a timeline semaphore!");
+
     // Swapchain creation:
+    uint32_t modeCount = 0;
+    vkGetPhysicalDeviceSurfacePresentModesKHR(PhysicalDevice, Surface, &modeCount,
+                                              nullptr);
+    SupportedPresentModes.resize(modeCount);
+    vkGetPhysicalDeviceSurfacePresentModesKHR(PhysicalDevice, Surface, &modeCount,
+                                              SupportedPresentModes.data());
+
     CreateSwapchain(width, height, true);
+
+    // Updated by resize events from now on:
+    Width = Swapchain.extent.width;
+    Height = Swapchain.extent.height;
 }
 
 VulkanContext::~VulkanContext()
 {
+    CollectDeferredDeletions(true);
+    mOldSwapchains.flush(*this);
+
     Swapchain.destroy_image_views(SwapchainImageViews);
     vkb::destroy_swapchain(Swapchain);
 
+    vkDestroySemaphore(Device, GraphicsTimeline.Semaphore, nullptr);
+
     vmaDestroyAllocator(Allocator);
 
     vkb::destroy_device(Device);
@@ -79,24 +180,70 @@ VulkanContext::~VulkanContext()
 
 void VulkanContext::CreateSwapchain(uint32_t width, uint32_t height, bool first_run)
 {
-    if (!first_run)
-        Swapchain.destroy_image_views(SwapchainImageViews);
-
-    // To manually specify format and present mode:
+    // To manually specify format:
     //.set_desired_format(VkSurfaceFormatKHR)
-    //.set_desired_present_mode(VkPresentModeKHR)
-    auto swap_ret = vkb::SwapchainBuilder(Device)
-                        .set_old_swapchain(Swapchain)
-                        .set_desired_extent(width, height)
-                        .build();
+    auto builder = vkb::SwapchainBuilder(Device)
+                       .set_old_swapchain(Swapchain)
+                       .set_desired_extent(width, height)
+                       .set_desired_present_mode(Config.PresentMode);
+
+    // Clamped to surface capabilities by vk-bootstrap:
+    if (Config.SwapchainImages != 0)
+        builder.set_desired_min_image_count(Config.SwapchainImages);
+
+    auto swap_ret = builder.build();
 
     if (!swap_ret)
         throw std::runtime_error(swap_ret.error().message());
 
-    vkb::destroy_swapchain(Swapchain);
+    if (!first_run)
+    {
+        auto views = SwapchainImageViews;
+
+        mOldSwapchains.push_back([swapchain = Swapchain, views]() mutable {
+            swapchain.destroy_image_views(views);
+            vkb::destroy_swapchain(swapchain);
+        });
+    }
 
     Swapchain = swap_ret.value();
 
     SwapchainImages = Swapchain.get_images().value();
     SwapchainImageViews = Swapchain.get_image_views().value();
+}
+
+VkExtent2D VulkanContext::GetRenderExtent() const
+{
+    return VkExtent2D{
+        .width = std::min(Width, Swapchain.extent.width),
+        .height = std::min(Height, Swapchain.extent.height),
+    };
+}
+
+void VulkanContext::RetireOldSwapchains(uint64_t timelineValue)
+{
+    if (!mOldSwapchains.empty())
+        DeferredDeletions.push_back(timelineValue, std::move(mOldSwapchains));
+}
+
+void VulkanContext::DeferDeletion(std::function<void()> &&deletor)
+{
+    DeferredDeletions.push_back(GraphicsTimeline.LastSubmitted, std::move(deletor));
+}
+
+void VulkanContext::CollectDeferredDeletions(bool all)
+{
+    if (DeferredDeletions.empty())
+        return;
+
+    if (all)
+    {
+        DeferredDeletions.flush(*this);
+        return;
+    }
+
+    uint64_t completed = 0;
+    vkGetSemaphoreCounterValue(Device, GraphicsTimeline.Semaphore, &completed);
+
+    DeferredDeletions.collect(*this, completed);
 }
\ No newline at end of file
@@ -1,10 +1,50 @@
 #pragma once
 
+#include "DeletionQueue.h"
+#include "Settings.h"
 #include "SystemWindow.h"
 #include "VkBootstrap.h"
 
 #include "vk_mem_alloc.h"
 
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+class DescriptorLayoutCache;
+class GeometryArena;
+class JobSystem;
+
+/// Timeline semaphore signalled by every frame submission to a queue,
+/// with monotonically increasing values.
+struct QueueTimeline {
+    VkSemaphore Semaphore = VK_NULL_HANDLE;
+    // Value that will be signalled by the most recent submission:
+    uint64_t LastSubmitted = 0;
+};
+
+/// Buffer uploads by the path they took. Thread safe, since renderers
+/// upload their resources while being constructed on a background thread.
+struct UploadStats {
+    struct Counter {
+        std::atomic<uint64_t> Count = 0;
+        std::atomic<uint64_t> Bytes = 0;
+
+        void Record(uint64_t size)
+        {
+            Count.fetch_add(1, std::memory_order_relaxed);
+            Bytes.fetch_add(size, std::memory_order_relaxed);
+        }
+    };
+
+    // Written straight into host visible device local memory:
+    Counter Direct;
+    // Through a staging buffer and a copy on the GPU:
+    Counter Staged;
+};
+
 /**
     Class encapsulating elements of Vulkan application
     that will typically be present during the whole lifetime of
@@ -14,27 +54,82 @@
 class VulkanContext {
   public:
     VulkanContext(uint32_t initial_width, uint32_t initial_height, std::string title,
-                  void *usr_ptr = nullptr);
+                  Settings settings = {}, void *usr_ptr = nullptr);
     ~VulkanContext();
 
+    // Previous swapchain is kept until RetireOldSwapchains, as frames in flight
+    // and pending presents may still use it:
     void CreateSwapchain(uint32_t width, uint32_t height, bool first_run = false);
+    // Takes the timeline value of a frame rendering into an image acquired from
+    // the current swapchain. Presents to older swapchains were queued before that
+    // frame, unlike its last submission the timeline doesn't cover them:
+    void RetireOldSwapchains(uint64_t timelineValue);
+
+    // Defers deletion until all work submitted so far has finished:
+    void DeferDeletion(std::function<void()> &&deletor);
+    // Runs deferred deletors the GPU is done with (all of them if the device is idle):
+    void CollectDeferredDeletions(bool all = false);
+
+    // Swapchain extent clamped to the current framebuffer size, they differ
+    // while recreation after a resize is still pending:
+    [[nodiscard]] VkExtent2D GetRenderExtent() const;
 
   public:
     SystemWindow Window;
 
+    // Frames in flight are read when constructing renderers,
+    // the rest when (re)creating the swapchain:
+    Settings Config;
+
     vkb::Instance Instance;
     vkb::PhysicalDevice PhysicalDevice;
     vkb::Device Device;
 
     VmaAllocator Allocator;
 
+    // Owned by Application, shared with renderers for parallel work:
+    JobSystem *Jobs = nullptr;
+    // Owned by Application, vertex and index data of all renderers:
+    GeometryArena *Geometry = nullptr;
+    // Owned by Application, deduplicated descriptor set layouts:
+    DescriptorLayoutCache *DescriptorLayouts = nullptr;
+
+    // Guards submissions/presents to queues, since renderers can be
+    // constructed (and upload their resources) on a background thread:
+    std::mutex QueueMutex;
+
+    // Graphics and compute work share the graphics queue, so a single
+    // timeline orders all frame submissions (guarded by QueueMutex):
+    QueueTimeline GraphicsTimeline;
+
     VkSurfaceKHR Surface;
     vkb::Swapchain Swapchain;
 
     std::vector<VkImage> SwapchainImages;
     std::vector<VkImageView> SwapchainImageViews;
 
+    std::vector<VkPresentModeKHR> SupportedPresentModes;
+
+    // Objects shared between renderers, keyed by GraphicsTimeline values:
+    DeferredDeletionQueue DeferredDeletions;
+
+    bool PipelineStatisticsSupported = false;
+    // Without it, indirect draws are issued one command at a time:
+    bool MultiDrawIndirectSupported = false;
+    bool MemoryBudgetSupported = false;
+    // Host visible device local memory covers the largest device local heap
+    // (integrated GPUs, resizable BAR), not just a small BAR window:
+    bool DirectUploadSupported = false;
+
+    UploadStats Uploads;
+
     bool SwapchainOk = true;
+    // Presentation works, but the swapchain should be recreated when convenient:
+    bool SwapchainSuboptimal = false;
     uint32_t Width;
     uint32_t Height;
+
+  private:
+    // Replaced swapchains, not yet tagged with a timeline value:
+    DeletionQueue mOldSwapchains;
 };
\ No newline at end of file
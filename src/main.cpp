@@ -1,12 +1,22 @@
 #include "Application.h"
+#include "JobBenchmark.h"
 
 #include <iostream>
 
-int main()
+int main(int argc, char *argv[])
 {
     try
     {
-        Application app;
+        auto settings = Settings::FromCommandLine(argc, argv);
+
+        if (settings.JobBenchmark)
+        {
+            JobSystem jobs;
+            std::cout << JobBenchmark::Run(jobs);
+            return 0;
+        }
+
+        Application app(settings);
         app.Run();
     }
 